@@ -26,6 +26,10 @@
 
 #pragma once
 
+#include <string>
+#include <exception>
+#include <iostream>
+
 #include "serialization.hpp"
 #include "tuple.hpp"
 
@@ -35,20 +39,36 @@ class active_message
   public:
     active_message() = default;
 
+    // func and args... are serialized into the message rather than copied
     template<class Function, class... Args,
-             __REQUIRES(can_serialize_all<Function,Args...>::value),
-             __REQUIRES(can_deserialize_all<Function,Args...>::value),
-             __REQUIRES(is_invocable<Function,Args...>::value)
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
             >
-    explicit active_message(Function func, Args... args)
-      : message_(func, args...)
+    explicit active_message(Function&& func, Args&&... args)
+      : message_(std::forward<Function>(func), std::forward<Args>(args)...)
     {}
 
+    // returns a closure_view which serializes like active_message(func, args...)
+    // senders which only need the serialization can serialize it without constructing a message
+    template<class Function, class... Args>
+    static auto view(Function&& func, Args&&... args)
+      -> decltype(serializable_closure::view(std::forward<Function>(func), std::forward<Args>(args)...))
+    {
+      return serializable_closure::view(std::forward<Function>(func), std::forward<Args>(args)...);
+    }
+
     any activate() const
     {
       return message_();
     }
 
+    // activates the active_message whose serialization is at data, without first deserializing it
+    static any activate_serialization(const char* data, std::size_t size)
+    {
+      return serializable_closure::invoke_serialization(data, size);
+    }
+
     template<class OutputArchive>
     friend void serialize(OutputArchive& ar, const active_message& self)
     {
@@ -66,6 +86,10 @@ class active_message
 };
 
 
+template<>
+struct type_fingerprint<active_message> : type_fingerprint<serializable_closure> {};
+
+
 class two_sided_active_message : private active_message
 {
   private:
@@ -74,21 +98,80 @@ class two_sided_active_message : private active_message
     // two_sided_active_message's constructor initializes the base active_message class with this function
     // as the function to call. The user's functions and arguments passed to two_sided_active_message's constructor are this function's arguments.
     // the result of this function is an active_message containing the reply
+    // if func throws, the reply calls failure_func(what, args2...) instead of reply_func, so the exception doesn't escape the handler
     template<class Function1, class Tuple1,
-             class Function2, class Tuple2>
-    static active_message apply_and_return_active_message_reply(Function1 func,       const Tuple1& args1,
-                                                                Function2 reply_func, const Tuple2& args2)
+             class Function2, class Tuple2,
+             class Function3>
+    static active_message apply_and_return_active_message_reply(Function1 func,         const Tuple1& args1,
+                                                                Function2 reply_func,   const Tuple2& args2,
+                                                                Function3 failure_func)
     {
       // XXX need to handle the case where user_result is void
 
-      // apply the user's function to the first tuple
-      auto user_result = apply(func, args1);
+      using indices = make_index_sequence<std::tuple_size<Tuple2>::value>;
+
+      try
+      {
+        // apply the user's function to the first tuple
+        auto user_result = ::apply(func, args1);
+
+        // make an active_message containing the reply, which serializes reply_func, user_result, and args2 in place
+        return make_reply(reply_func, user_result, args2, indices());
+      }
+      catch(const std::exception& e)
+      {
+        return make_reply(failure_func, std::string(e.what()), args2, indices());
+      }
+      catch(...)
+      {
+        return make_reply(failure_func, std::string("unknown exception"), args2, indices());
+      }
+    }
+
+    template<class... Args2>
+    static void terminate_on_failure(std::string what, Args2...)
+    {
+      std::cerr << "two_sided_active_message: Request failed: " << what << std::endl;
+      std::terminate();
+    }
 
-      // concatenate reply_func, user_result, and args2 into a single tuple
-      auto constructor_args = std::tuple_cat(std::make_tuple(reply_func, user_result), args2);
+    template<class Function2, class Result1, class Tuple2, size_t... Indices>
+    static active_message make_reply(Function2 reply_func, const Result1& user_result, const Tuple2& args2, index_sequence<Indices...>)
+    {
+      return active_message(reply_func, user_result, std::get<Indices>(args2)...);
+    }
 
-      // make an active_message containing the reply
-      return make_from_tuple<active_message>(constructor_args);
+    template<class Function1, class Tuple1, class Function2, class Tuple2, class Function3>
+    using reply_function_ptr = active_message (*)(Function1, const Tuple1&, Function2, const Tuple2&, Function3);
+
+    template<class Function1, class... Args1, class Function2, class... Args2, class Function3, size_t... Indices1, size_t... Indices2>
+    static closure_view_of<
+      reply_function_ptr<
+        typename std::decay<Function1>::type, std::tuple<typename std::decay<Args1>::type...>,
+        typename std::decay<Function2>::type, std::tuple<typename std::decay<Args2>::type...>,
+        typename std::decay<Function3>::type
+      >,
+      Function1, Args1..., Function2, Args2..., Function3
+    >
+      view_impl(Function1&& func,         const std::tuple<Args1...>& args1, index_sequence<Indices1...>,
+                Function2&& reply_func,   const std::tuple<Args2...>& args2, index_sequence<Indices2...>,
+                Function3&& failure_func)
+    {
+      using function1_type = typename std::decay<Function1>::type;
+      using tuple1_type = std::tuple<typename std::decay<Args1>::type...>;
+      using function2_type = typename std::decay<Function2>::type;
+      using tuple2_type = std::tuple<typename std::decay<Args2>::type...>;
+      using function3_type = typename std::decay<Function3>::type;
+
+      // a tuple serializes as its elements, so the elements of args1 and args2 stand for the tuples themselves
+      return serializable_closure::view_as<
+        reply_function_ptr<function1_type,tuple1_type,function2_type,tuple2_type,function3_type>,
+        function1_type, tuple1_type, function2_type, tuple2_type, function3_type
+      >(&apply_and_return_active_message_reply<function1_type,tuple1_type,function2_type,tuple2_type,function3_type>,
+        func, std::get<Indices1>(args1)...,
+        reply_func, std::get<Indices2>(args2)...,
+        failure_func
+      );
     }
 
 
@@ -98,10 +181,11 @@ class two_sided_active_message : private active_message
     // XXX we also need to require that the result of Function1 is serializable/deserializable
     template<class Function1, class Tuple1,
              class Function2, class... Args2,
+             class Function3,
 
              // all arguments must be serializable and deserializable
-             __REQUIRES(can_serialize_all<Function1,Tuple1,Function2,Args2...>::value),
-             __REQUIRES(can_deserialize_all<Function1,Tuple1,Function2,Args2...>::value),
+             __REQUIRES(can_serialize_all<Function1,Tuple1,Function2,Args2...,Function3>::value),
+             __REQUIRES(can_deserialize_all<Function1,Tuple1,Function2,Args2...,Function3>::value),
 
              // auto func_result = func(args1...) must be well-formed
              __REQUIRES(can_apply<Function1,Tuple1>::value),
@@ -110,12 +194,30 @@ class two_sided_active_message : private active_message
 
              // reply_func(func_result, args2...) must be well-formed
              // XXX need to handle the case where Result1 is void
+             __REQUIRES(is_invocable<Function2,Result1,Args2...>::value),
+
+             // failure_func(what, args2...) must be well-formed
+             __REQUIRES(is_invocable<Function3,std::string,Args2...>::value)
+            >
+    two_sided_active_message(Function1 func,         const Tuple1& args1,
+                             Function2 reply_func,   const std::tuple<Args2...>& args2,
+                             Function3 failure_func)
+      : super_t(&apply_and_return_active_message_reply<Function1,Tuple1,Function2,std::tuple<Args2...>,Function3>,
+                func, args1, reply_func, args2, failure_func)
+    {}
+
+    // without a failure_func, an exception thrown by func is reported by the sender, which then terminates
+    template<class Function1, class Tuple1,
+             class Function2, class... Args2,
+             __REQUIRES(can_serialize_all<Function1,Tuple1,Function2,Args2...>::value),
+             __REQUIRES(can_deserialize_all<Function1,Tuple1,Function2,Args2...>::value),
+             __REQUIRES(can_apply<Function1,Tuple1>::value),
+             class Result1 = apply_result_t<Function1,Tuple1>,
              __REQUIRES(is_invocable<Function2,Result1,Args2...>::value)
             >
     two_sided_active_message(Function1 func,       const Tuple1& args1,
                              Function2 reply_func, const std::tuple<Args2...>& args2)
-      : super_t(&apply_and_return_active_message_reply<Function1,Tuple1,Function2,std::tuple<Args2...>>,
-                func, args1, reply_func, args2)
+      : two_sided_active_message(func, args1, reply_func, args2, &terminate_on_failure<Args2...>)
     {}
 
     active_message activate() const
@@ -123,6 +225,20 @@ class two_sided_active_message : private active_message
       return any_cast<active_message>(super_t::activate());
     }
 
+    // returns a closure_view which serializes like two_sided_active_message(func, args1, reply_func, args2, failure_func),
+    // where args1 and args2 are tuples of the arguments or references to them, as from std::forward_as_tuple
+    // the arguments are serialized where they are rather than copied into tuples
+    template<class Function1, class... Args1, class Function2, class... Args2, class Function3>
+    static auto view(Function1&& func, const std::tuple<Args1...>& args1, Function2&& reply_func, const std::tuple<Args2...>& args2, Function3&& failure_func)
+      -> decltype(view_impl(std::forward<Function1>(func), args1, make_index_sequence<sizeof...(Args1)>(),
+                            std::forward<Function2>(reply_func), args2, make_index_sequence<sizeof...(Args2)>(),
+                            std::forward<Function3>(failure_func)))
+    {
+      return view_impl(std::forward<Function1>(func), args1, make_index_sequence<sizeof...(Args1)>(),
+                       std::forward<Function2>(reply_func), args2, make_index_sequence<sizeof...(Args2)>(),
+                       std::forward<Function3>(failure_func));
+    }
+
     template<class OutputArchive>
     friend void serialize(OutputArchive& ar, const two_sided_active_message& self)
     {
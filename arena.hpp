@@ -0,0 +1,235 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+
+// arena is a bump allocator for temporaries which all die at the same time
+// memory is returned all at once by reset(), which keeps the first block for reuse,
+// so an arena which is reset regularly stops allocating once its first block is large enough
+// an arena is not thread safe; give each thread its own
+class arena
+{
+  public:
+    inline explicit arena(std::size_t block_size = 64 << 10)
+      : block_size_(block_size),
+        current_(nullptr),
+        end_(nullptr),
+        num_scopes_(0)
+    {}
+
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    inline ~arena()
+    {
+      for(block& b : blocks_)
+      {
+        ::operator delete(b.data);
+      }
+    }
+
+    // alignment must be a power of two
+    inline void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t))
+    {
+      char* result = align(current_, alignment);
+
+      if(current_ == nullptr || result + size > end_)
+      {
+        // requests larger than a block get a block of their own
+        std::size_t new_block_size = size + alignment > block_size_ ? size + alignment : block_size_;
+
+        blocks_.push_back(block{static_cast<char*>(::operator new(new_block_size)), new_block_size});
+        current_ = blocks_.back().data;
+        end_ = current_ + new_block_size;
+
+        result = align(current_, alignment);
+      }
+
+      current_ = result + size;
+      return result;
+    }
+
+    // releases everything allocated since the last reset
+    // at most one block of the usual size is kept, so an oversized request doesn't pin its memory forever
+    inline void reset()
+    {
+      std::size_t num_kept = !blocks_.empty() && blocks_[0].size == block_size_ ? 1 : 0;
+
+      for(std::size_t i = num_kept; i < blocks_.size(); ++i)
+      {
+        ::operator delete(blocks_[i].data);
+      }
+
+      blocks_.resize(num_kept);
+      current_ = num_kept ? blocks_[0].data : nullptr;
+      end_ = num_kept ? current_ + blocks_[0].size : nullptr;
+    }
+
+    // the number of bytes held by the arena, whether or not they are in use
+    inline std::size_t capacity() const
+    {
+      std::size_t result = 0;
+      for(const block& b : blocks_)
+      {
+        result += b.size;
+      }
+
+      return result;
+    }
+
+  private:
+    friend class arena_scope;
+
+    struct block
+    {
+      char* data;
+      std::size_t size;
+    };
+
+    inline static char* align(char* ptr, std::size_t alignment)
+    {
+      std::uintptr_t address = reinterpret_cast<std::uintptr_t>(ptr);
+      return reinterpret_cast<char*>((address + alignment - 1) & ~(alignment - 1));
+    }
+
+    std::size_t block_size_;
+    std::vector<block> blocks_;
+    char* current_;
+    char* end_;
+    int num_scopes_;
+};
+
+
+// arena_scope resets its arena when the outermost arena_scope on it ends,
+// so a handler which calls another handler doesn't free its caller's temporaries
+class arena_scope
+{
+  public:
+    inline explicit arena_scope(arena& a)
+      : arena_(a)
+    {
+      ++arena_.num_scopes_;
+    }
+
+    arena_scope(const arena_scope&) = delete;
+    arena_scope& operator=(const arena_scope&) = delete;
+
+    inline ~arena_scope()
+    {
+      if(--arena_.num_scopes_ == 0)
+      {
+        arena_.reset();
+      }
+    }
+
+  private:
+    arena& arena_;
+};
+
+
+// arena_allocator<T> allocates from an arena, and deallocation does nothing
+// a default-constructed arena_allocator uses the heap instead,
+// and containers copied from arena-allocated containers use the heap, so that copies may outlive the arena
+template<class T>
+class arena_allocator
+{
+  public:
+    using value_type = T;
+
+    template<class U>
+    struct rebind
+    {
+      using other = arena_allocator<U>;
+    };
+
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::false_type;
+    using propagate_on_container_swap = std::false_type;
+
+    inline arena_allocator() noexcept
+      : arena_(nullptr)
+    {}
+
+    inline explicit arena_allocator(arena& a) noexcept
+      : arena_(&a)
+    {}
+
+    template<class U>
+    inline arena_allocator(const arena_allocator<U>& other) noexcept
+      : arena_(other.get_arena())
+    {}
+
+    inline T* allocate(std::size_t n)
+    {
+      if(arena_)
+      {
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+      }
+
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    inline void deallocate(T* ptr, std::size_t) noexcept
+    {
+      if(!arena_)
+      {
+        ::operator delete(ptr);
+      }
+    }
+
+    inline arena_allocator select_on_container_copy_construction() const
+    {
+      return arena_allocator();
+    }
+
+    // nullptr when this allocator uses the heap
+    inline arena* get_arena() const
+    {
+      return arena_;
+    }
+
+    template<class U>
+    inline bool operator==(const arena_allocator<U>& other) const
+    {
+      return arena_ == other.get_arena();
+    }
+
+    template<class U>
+    inline bool operator!=(const arena_allocator<U>& other) const
+    {
+      return !(*this == other);
+    }
+
+  private:
+    arena* arena_;
+};
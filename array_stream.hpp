@@ -0,0 +1,305 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include <ostream>
+#include <streambuf>
+
+#include "small_buffer.hpp"
+
+
+// small_buffer_output_stream formats into a small_buffer's inline storage, and moves to the heap only if it overflows
+// the serialization is written once either way: what was written inline is copied to the heap, and writing continues there
+// like basic_string_output_stream, it may seek back to a position already written
+// call commit() to record what was written in the small_buffer
+template<std::size_t N, class Allocator>
+class small_buffer_output_stream : public std::ostream
+{
+  public:
+    inline explicit small_buffer_output_stream(small_buffer<N,Allocator>& result)
+      : std::ostream(),
+        buffer_(result)
+    {
+      // pass buffer_ to ostream *after* buffer_ has been constructed
+      std::ostream::rdbuf(&buffer_);
+    }
+
+    // the number of characters written so far
+    inline std::size_t size() const
+    {
+      return buffer_.size();
+    }
+
+    inline void commit()
+    {
+      flush();
+      buffer_.commit();
+    }
+
+  private:
+    class small_buffer_buffer : public std::streambuf
+    {
+      public:
+        using string_type = typename small_buffer<N,Allocator>::string_type;
+
+        inline explicit small_buffer_buffer(small_buffer<N,Allocator>& result)
+          : result_(result),
+            heap_(result.get_allocator()),
+            is_inline_(true),
+            inline_size_(0),
+            position_(0)
+        {
+          // while the serialization fits, the put area is the inline storage, so writing it needn't call overflow()
+          setp(result_.inline_data(), result_.inline_data() + N);
+        }
+
+        small_buffer_buffer(const small_buffer_buffer&) = delete;
+
+        inline std::size_t size() const
+        {
+          return is_inline_ ? inline_extent() : heap_.size();
+        }
+
+        inline void commit()
+        {
+          if(is_inline_)
+          {
+            result_.set_inline_size(inline_extent());
+          }
+          else
+          {
+            result_.assign(std::move(heap_));
+          }
+        }
+
+      protected:
+        inline int_type overflow(int_type c) override
+        {
+          if(!traits_type::eq_int_type(c, traits_type::eof()))
+          {
+            char_type character = traits_type::to_char_type(c);
+            put(&character, 1);
+          }
+
+          return traits_type::not_eof(c);
+        }
+
+        inline std::streamsize xsputn(const char_type* data, std::streamsize size) override
+        {
+          if(is_inline_ && size <= epptr() - pptr())
+          {
+            traits_type::copy(pptr(), data, size);
+            pbump(static_cast<int>(size));
+          }
+          else
+          {
+            put(data, size);
+          }
+
+          return size;
+        }
+
+        inline pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override
+        {
+          off_type base = direction == std::ios_base::beg ? 0 :
+                          direction == std::ios_base::cur ? static_cast<off_type>(position()) :
+                          static_cast<off_type>(size());
+
+          return seekpos(pos_type(base + offset), which);
+        }
+
+        // only positions already written may be sought
+        inline pos_type seekpos(pos_type position, std::ios_base::openmode which) override
+        {
+          off_type offset = position;
+
+          if(!(which & std::ios_base::out) || offset < 0 || static_cast<std::size_t>(offset) > size())
+          {
+            return pos_type(off_type(-1));
+          }
+
+          if(is_inline_)
+          {
+            // remember how far the serialization extends before moving the put pointer back
+            inline_size_ = inline_extent();
+            setp(pbase(), epptr());
+            pbump(static_cast<int>(offset));
+          }
+          else
+          {
+            position_ = static_cast<std::size_t>(offset);
+          }
+
+          return position;
+        }
+
+      private:
+        inline std::size_t inline_extent() const
+        {
+          return std::max(inline_size_, static_cast<std::size_t>(pptr() - pbase()));
+        }
+
+        inline std::size_t position() const
+        {
+          return is_inline_ ? static_cast<std::size_t>(pptr() - pbase()) : position_;
+        }
+
+        // copies what was written inline to the heap, where writing continues
+        inline void move_to_heap()
+        {
+          inline_size_ = inline_extent();
+          position_ = pptr() - pbase();
+
+          heap_.reserve(2 * N);
+          heap_.assign(pbase(), inline_size_);
+
+          setp(nullptr, nullptr);
+          is_inline_ = false;
+        }
+
+        // overwrites what follows the position, and appends what extends past the end
+        inline void put(const char_type* data, std::size_t size)
+        {
+          if(is_inline_)
+          {
+            move_to_heap();
+          }
+
+          std::size_t overwritten = std::min(size, heap_.size() - position_);
+          traits_type::copy(&heap_[position_], data, overwritten);
+
+          heap_.append(data + overwritten, size - overwritten);
+          position_ += size;
+        }
+
+        small_buffer<N,Allocator>& result_;
+        string_type heap_;
+        bool is_inline_;
+
+        // how far the inline serialization extended before the put pointer last moved back
+        std::size_t inline_size_;
+
+        // the position in heap_
+        std::size_t position_;
+    };
+
+    small_buffer_buffer buffer_;
+};
+
+
+
+// counting_output_stream discards what is written to it and counts the characters
+// it measures a serialization before it is written, and never allocates
+// like the other streams here, it may seek back to a position already written, which it counts only once
+class counting_output_stream : public std::ostream
+{
+  public:
+    inline counting_output_stream()
+      : std::ostream(),
+        buffer_()
+    {
+      // pass buffer_ to ostream *after* buffer_ has been constructed
+      std::ostream::rdbuf(&buffer_);
+    }
+
+    // the number of characters written so far
+    inline std::size_t size() const
+    {
+      return buffer_.size();
+    }
+
+  private:
+    class counting_buffer : public std::streambuf
+    {
+      public:
+        inline counting_buffer()
+          : size_(0),
+            position_(0)
+        {}
+
+        counting_buffer(const counting_buffer&) = delete;
+
+        inline std::size_t size() const
+        {
+          return size_;
+        }
+
+      protected:
+        inline int_type overflow(int_type c) override
+        {
+          if(!traits_type::eq_int_type(c, traits_type::eof()))
+          {
+            advance(1);
+          }
+
+          return traits_type::not_eof(c);
+        }
+
+        inline std::streamsize xsputn(const char_type*, std::streamsize size) override
+        {
+          advance(size);
+          return size;
+        }
+
+        inline pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override
+        {
+          off_type base = direction == std::ios_base::beg ? 0 :
+                          direction == std::ios_base::cur ? static_cast<off_type>(position_) :
+                          static_cast<off_type>(size_);
+
+          return seekpos(pos_type(base + offset), which);
+        }
+
+        inline pos_type seekpos(pos_type position, std::ios_base::openmode which) override
+        {
+          off_type offset = position;
+
+          if(!(which & std::ios_base::out) || offset < 0 || static_cast<std::size_t>(offset) > size_)
+          {
+            return pos_type(off_type(-1));
+          }
+
+          position_ = static_cast<std::size_t>(offset);
+          return position;
+        }
+
+      private:
+        inline void advance(std::size_t n)
+        {
+          position_ += n;
+          size_ = std::max(size_, position_);
+        }
+
+        std::size_t size_;
+        std::size_t position_;
+    };
+
+    counting_buffer buffer_;
+};
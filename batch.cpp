@@ -0,0 +1,122 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// $ ./openshmem-am-root/bin/oshc++ -std=c++11 batch.cpp 
+// $ ./openshmem-am-root/bin/oshrun ./a.out -n 2
+// PE 1: Received 10 updates in a single message
+// PE 0: Squares: 0 1 4 9 16
+// PE 0: Call 5 failed: negative input
+// PE 0: Squares after the failed call: 36 49
+
+#include <iostream>
+#include <future>
+#include <vector>
+#include <stdexcept>
+#include <cassert>
+
+#include "batch.hpp"
+
+
+int total = 0;
+int num_updates = 0;
+
+void update(int value)
+{
+  total += value;
+  ++num_updates;
+}
+
+void report(int expected_total)
+{
+  assert(total == expected_total);
+  std::cout << "PE " << shmem_my_pe() << ": Received " << num_updates << " updates in a single message" << std::endl;
+}
+
+int square(int value)
+{
+  if(value < 0)
+  {
+    throw std::runtime_error("negative input");
+  }
+
+  return value * value;
+}
+
+int main()
+{
+  if(shmem_my_pe() == 0)
+  {
+    // the calls of a batch are executed in the order they were added
+    batch updates(1);
+    for(int i = 0; i < 10; ++i)
+    {
+      updates.add(update, i);
+    }
+    updates.add(report, 45);
+    assert(updates.size() == 11);
+
+    updates.submit();
+    assert(updates.empty());
+
+    // a single reply fulfills the futures of every call in a twoway_batch
+    twoway_batch<int> squares(1);
+    for(int i = 0; i < 5; ++i)
+    {
+      squares.add(square, i);
+    }
+
+    // a call which throws fails only its own future
+    squares.add(square, -1);
+    squares.add(square, 6);
+    squares.add(square, 7);
+
+    std::vector<std::future<int>> results = squares.submit();
+    assert(results.size() == 8);
+
+    std::cout << "PE 0: Squares:";
+    for(int i = 0; i < 5; ++i)
+    {
+      std::cout << " " << results[i].get();
+    }
+    std::cout << std::endl;
+
+    try
+    {
+      results[5].get();
+      assert(false);
+    }
+    catch(const std::exception& e)
+    {
+      std::cout << "PE 0: Call 5 failed: " << e.what() << std::endl;
+    }
+
+    std::cout << "PE 0: Squares after the failed call: " << results[6].get() << " " << results[7].get() << std::endl;
+  }
+
+  system_context().wait_for_all();
+
+  shmem_barrier_all();
+}
@@ -0,0 +1,190 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <future>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "serialization.hpp"
+#include "execution_context.hpp"
+
+
+// batch collects calls bound for a single node and submits them as a single one-sided message,
+// whose handler executes the calls in the order they were added
+// the calls share one header and one credit rather than paying for one each
+//
+//   batch b(node);
+//   for(const update& u : updates) b.add(apply_update, u);
+//   b.submit();
+class batch
+{
+  public:
+    inline explicit batch(std::size_t node, message_priority priority = message_priority::normal)
+      : node_(node),
+        priority_(priority),
+        size_(0)
+    {}
+
+    inline std::size_t node() const
+    {
+      return node_;
+    }
+
+    // the number of calls waiting to be submitted
+    inline std::size_t size() const
+    {
+      return size_;
+    }
+
+    inline bool empty() const
+    {
+      return size_ == 0;
+    }
+
+    // f and args... are serialized into the batch immediately
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    void add(Function&& f, Args&&... args)
+    {
+      string_output_stream os(calls_);
+      output_archive archive(os);
+      archive(serializable_closure::view(std::forward<Function>(f), std::forward<Args>(args)...));
+
+      ++size_;
+    }
+
+    // sends the calls added so far and empties the batch
+    inline submission_status submit()
+    {
+      if(empty())
+      {
+        return submission_status::sent;
+      }
+
+      std::string calls;
+      calls.swap(calls_);
+      size_ = 0;
+
+      return system_context().one_sided_execute(priority_, node_, &execute_calls, std::move(calls));
+    }
+
+  private:
+    // the calls are executed where they lie in the message rather than deserialized into closures first
+    static void execute_calls(const std::string& calls)
+    {
+      serializable_closure::for_each_serialization(calls.data(), calls.size(), [](const char* data, std::size_t size)
+      {
+        serializable_closure::invoke_serialization(data, size);
+      });
+    }
+
+    std::size_t node_;
+    message_priority priority_;
+
+    // the closures' serializations, written back to back
+    std::string calls_;
+    std::size_t size_;
+};
+
+
+// twoway_batch<T> is a batch whose calls return results convertible to T
+// submit() returns a future for each call, and a single reply carrying every result fulfills them all
+template<class T>
+class twoway_batch
+{
+  public:
+    inline explicit twoway_batch(std::size_t node, message_priority priority = message_priority::normal)
+      : node_(node),
+        priority_(priority),
+        size_(0)
+    {}
+
+    inline std::size_t node() const
+    {
+      return node_;
+    }
+
+    inline std::size_t size() const
+    {
+      return size_;
+    }
+
+    inline bool empty() const
+    {
+      return size_ == 0;
+    }
+
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(std::is_convertible<invoke_result_t<typename std::decay<Function>::type,typename std::decay<Args>::type...>,T>::value)
+            >
+    void add(Function&& f, Args&&... args)
+    {
+      // every call in the batch returns exactly T, so the reply is a std::vector<T>
+      auto call = &invoke_as_result<typename std::decay<Function>::type,typename std::decay<Args>::type...>;
+
+      string_output_stream os(calls_);
+      output_archive archive(os);
+      archive(serializable_closure::view(call, std::forward<Function>(f), std::forward<Args>(args)...));
+
+      ++size_;
+    }
+
+    // sends the calls added so far and empties the batch
+    // the futures are returned in the order their calls were added
+    inline std::vector<std::future<T>> submit()
+    {
+      std::string calls;
+      calls.swap(calls_);
+
+      std::size_t count = size_;
+      size_ = 0;
+
+      return system_context().two_sided_execute_batch<T>(priority_, node_, calls, count);
+    }
+
+  private:
+    template<class Function, class... Args>
+    static T invoke_as_result(Function f, Args... args)
+    {
+      return f(std::move(args)...);
+    }
+
+    std::size_t node_;
+    message_priority priority_;
+    std::string calls_;
+    std::size_t size_;
+};
@@ -0,0 +1,188 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+
+// the exception delivered through a future whose deadline passed before its reply arrived
+class timeout_error : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+
+// the exception delivered through a future whose request was cancelled before its reply arrived
+class cancellation_error : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+
+class cancellation_registration;
+
+
+// cancellation_token lets one party cancel the requests another party made with it
+// copies of a cancellation_token share their state, so cancelling any copy cancels them all
+class cancellation_token
+{
+  public:
+    inline cancellation_token()
+      : state_(std::make_shared<state>())
+    {}
+
+    // calls every registered callback exactly once
+    // cancelling a token which has already been cancelled has no effect
+    inline void cancel() const
+    {
+      std::unordered_map<std::uint64_t, std::function<void()>> callbacks;
+
+      {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+
+        if(state_->cancelled) return;
+
+        state_->cancelled = true;
+        callbacks.swap(state_->callbacks);
+      }
+
+      // callbacks are called without holding the lock, so they may deregister themselves
+      for(auto& callback : callbacks)
+      {
+        callback.second();
+      }
+    }
+
+    inline bool is_cancelled() const
+    {
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      return state_->cancelled;
+    }
+
+    // arranges for callback to be called when this token is cancelled,
+    // or calls it immediately if this token has already been cancelled
+    // the callback is deregistered when the returned registration is destroyed
+    inline cancellation_registration on_cancel(std::function<void()> callback) const;
+
+  private:
+    friend class cancellation_registration;
+
+    struct state
+    {
+      state()
+        : cancelled(false),
+          next_key(0)
+      {}
+
+      std::mutex mutex;
+      bool cancelled;
+      std::uint64_t next_key;
+      std::unordered_map<std::uint64_t, std::function<void()>> callbacks;
+    };
+
+    std::shared_ptr<state> state_;
+};
+
+
+// cancellation_registration owns a callback registered with a cancellation_token
+// it doesn't keep the token alive
+class cancellation_registration
+{
+  public:
+    inline cancellation_registration()
+      : key_(0)
+    {}
+
+    inline cancellation_registration(cancellation_registration&& other)
+      : state_(std::move(other.state_)),
+        key_(other.key_)
+    {}
+
+    inline cancellation_registration& operator=(cancellation_registration&& other)
+    {
+      reset();
+      state_ = std::move(other.state_);
+      key_ = other.key_;
+      return *this;
+    }
+
+    inline ~cancellation_registration()
+    {
+      reset();
+    }
+
+    // deregisters the callback, if it hasn't already been called
+    inline void reset()
+    {
+      if(std::shared_ptr<cancellation_token::state> state = state_.lock())
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->callbacks.erase(key_);
+      }
+
+      state_.reset();
+    }
+
+  private:
+    friend class cancellation_token;
+
+    inline cancellation_registration(const std::shared_ptr<cancellation_token::state>& state, std::uint64_t key)
+      : state_(state),
+        key_(key)
+    {}
+
+    std::weak_ptr<cancellation_token::state> state_;
+    std::uint64_t key_;
+};
+
+
+inline cancellation_registration cancellation_token::on_cancel(std::function<void()> callback) const
+{
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+
+    if(!state_->cancelled)
+    {
+      std::uint64_t key = state_->next_key++;
+      state_->callbacks.emplace(key, std::move(callback));
+      return cancellation_registration(state_, key);
+    }
+  }
+
+  callback();
+  return cancellation_registration();
+}
+
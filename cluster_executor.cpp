@@ -0,0 +1,124 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// $ ./openshmem-am-root/bin/oshc++ -std=c++11 cluster_executor.cpp 
+// $ ./openshmem-am-root/bin/oshrun ./a.out -n 3
+// PE 0: 10 indices in 3 partitions: OK
+// PE 0: 2 indices in 2 partitions: OK
+// PE 0: 0 indices in 0 partitions: OK
+// PE 0: Equal keys executed on the same node: OK
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "cluster_executor.hpp"
+
+
+// returns i along with the node which executed it, so the caller can check the partitions
+std::vector<std::size_t> where(std::size_t i)
+{
+  return std::vector<std::size_t>{i, static_cast<std::size_t>(shmem_my_pe())};
+}
+
+int node_of(std::vector<int>)
+{
+  return shmem_my_pe();
+}
+
+// checks that the indices [0, shape) came back in order,
+// and that each node executed a single contiguous partition, no larger than any other by more than one
+void check_partitions(const cluster_executor& exec, std::size_t shape)
+{
+  std::vector<std::vector<std::size_t>> results = exec.bulk_twoway_execute(where, shape).get();
+  assert(results.size() == shape);
+
+  std::size_t num_partitions = 0;
+  std::size_t smallest = shape;
+  std::size_t largest = 0;
+
+  for(std::size_t begin = 0; begin < shape;)
+  {
+    std::size_t end = begin;
+    while(end < shape && results[end][1] == results[begin][1])
+    {
+      assert(results[end][0] == end);
+      ++end;
+    }
+
+    ++num_partitions;
+    smallest = std::min(smallest, end - begin);
+    largest = std::max(largest, end - begin);
+
+    begin = end;
+  }
+
+  std::size_t expected_partitions = std::min(shape, exec.nodes().size());
+  assert(num_partitions == expected_partitions);
+  assert(shape == 0 || largest - smallest <= 1);
+
+  std::cout << "PE 0: " << shape << " indices in " << num_partitions << " partitions: OK" << std::endl;
+}
+
+int main()
+{
+  if(shmem_my_pe() == 0)
+  {
+    cluster_executor exec;
+
+    // more indices than nodes
+    check_partitions(exec, 3 * exec.nodes().size() + 1);
+
+    // fewer indices than nodes: some nodes receive nothing
+    if(exec.nodes().size() > 1)
+    {
+      check_partitions(exec, exec.nodes().size() - 1);
+    }
+
+    // no indices: no messages, and an empty result
+    check_partitions(exec, 0);
+
+    // bulk_execute() reports whether each partition was sent
+    std::vector<submission_status> statuses = exec.bulk_execute(where, 10);
+    assert(statuses.size() == exec.num_partitions(10));
+    assert(std::count(statuses.begin(), statuses.end(), submission_status::would_block) == 0);
+    exec.context().wait_for_all();
+
+    // std::hash isn't defined for std::vector<int>, so key_affinity hashes its serialization
+    cluster_executor by_key(load_balancing_policy::key_affinity);
+    std::vector<int> key{1, 2, 3};
+
+    int first = by_key.twoway_execute(node_of, key).get();
+    int second = by_key.twoway_execute(node_of, key).get();
+    assert(first == second);
+
+    std::cout << "PE 0: Equal keys executed on the same node: OK" << std::endl;
+  }
+
+  shmem_barrier_all();
+}
@@ -0,0 +1,382 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "serialization.hpp"
+#include "execution_context.hpp"
+#include "remote_executor.hpp"
+#include <stdexcept>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <string>
+
+
+// how cluster_executor chooses the node which executes each submission
+enum class load_balancing_policy
+{
+  round_robin,       // cycle through the nodes
+  least_outstanding, // choose the node with the fewest unfinished requests from this node
+  key_affinity       // hash the first argument, or its serialization when std::hash isn't defined for it,
+                     // so submissions with equal first arguments execute on the same node
+};
+
+
+// parses the names of load_balancing_policy's enumerators
+inline load_balancing_policy parse_load_balancing_policy(const char* name)
+{
+  if(std::strcmp(name, "round_robin") == 0)       return load_balancing_policy::round_robin;
+  if(std::strcmp(name, "least_outstanding") == 0) return load_balancing_policy::least_outstanding;
+  if(std::strcmp(name, "key_affinity") == 0)      return load_balancing_policy::key_affinity;
+
+  throw std::runtime_error(std::string("parse_load_balancing_policy(): Unknown policy ") + name);
+}
+
+
+// cluster_executor executes work on a set of nodes, choosing a node for each submission
+// copies of a cluster_executor share their round-robin position
+class cluster_executor
+{
+  public:
+    inline cluster_executor(std::vector<std::size_t> nodes, load_balancing_policy policy = load_balancing_policy::round_robin)
+      : nodes_(std::move(nodes)),
+        policy_(policy),
+        next_(std::make_shared<std::atomic<std::size_t>>(0))
+    {
+      if(nodes_.empty())
+      {
+        throw std::runtime_error("cluster_executor: Empty node set.");
+      }
+
+      for(std::size_t node : nodes_)
+      {
+        if(node >= context().node_count())
+        {
+          throw std::runtime_error("Invalid node index.");
+        }
+      }
+    }
+
+    // the nodes [first, last)
+    inline cluster_executor(std::size_t first, std::size_t last, load_balancing_policy policy = load_balancing_policy::round_robin)
+      : cluster_executor(node_range(first, last), policy)
+    {}
+
+    // every node
+    inline explicit cluster_executor(load_balancing_policy policy = load_balancing_policy::round_robin)
+      : cluster_executor(0, system_context().node_count(), policy)
+    {}
+
+    inline execution_context& context() const
+    {
+      return system_context();
+    }
+
+    inline const std::vector<std::size_t>& nodes() const
+    {
+      return nodes_;
+    }
+
+    inline load_balancing_policy policy() const
+    {
+      return policy_;
+    }
+
+    // returns the node which the next submission of f(args...) would execute on
+    template<class... Args>
+    std::size_t select_node(const Args&... args) const
+    {
+      switch(policy_)
+      {
+        case load_balancing_policy::least_outstanding:
+        {
+          return least_outstanding_node();
+        }
+
+        case load_balancing_policy::key_affinity:
+        {
+          return nodes_[hash_first(args...) % nodes_.size()];
+        }
+
+        case load_balancing_policy::round_robin:
+        {
+          break;
+        }
+      }
+
+      return next_node();
+    }
+
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    submission_status execute(Function&& f, Args&&... args) const
+    {
+      return remote_executor(select_node(args...)).execute(std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    std::future<invoke_result_t<typename std::decay<Function>::type,typename std::decay<Args>::type...>>
+      twoway_execute(Function&& f, Args&&... args) const
+    {
+      return remote_executor(select_node(args...)).twoway_execute(std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    // the node is chosen when predecessor becomes ready; under key_affinity, the key is the first of args
+    template<class Function, class T, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             class Result = typename then_execute_result<typename std::decay<Function>::type,T,typename std::decay<Args>::type...>::type
+            >
+    std::future<Result>
+      then_execute(Function&& f, std::future<T>& predecessor, Args&&... args) const
+    {
+      return remote_executor(select_node(args...)).then_execute(std::forward<Function>(f), predecessor, std::forward<Args>(args)...);
+    }
+
+    // executes f(i, args...) for each i in [0, shape), divided into contiguous partitions, one per node
+    // each partition travels in a single one-sided message
+    // returns the submission_status of each partition, in order of i; partition p is [partition_begin(shape, p), partition_begin(shape, p + 1))
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,std::size_t,typename std::decay<Args>::type...>::value)
+            >
+    std::vector<submission_status> bulk_execute(Function&& f, std::size_t shape, Args&&... args) const
+    {
+      std::vector<submission_status> result;
+      result.reserve(num_partitions(shape));
+
+      std::size_t first_node = next_node_index();
+
+      for(std::size_t partition = 0; partition < num_partitions(shape); ++partition)
+      {
+        std::size_t node = nodes_[(first_node + partition) % nodes_.size()];
+
+        result.push_back(context().one_sided_execute(node,
+          &bulk_invoke<typename std::decay<Function>::type,typename std::decay<Args>::type...>,
+          f, partition_begin(shape, partition), partition_begin(shape, partition + 1), args...
+        ));
+      }
+
+      return result;
+    }
+
+    // executes f(i, args...) for each i in [0, shape), divided into contiguous partitions, one per node,
+    // and returns a future for the vector of their results, in order of i
+    // each partition travels in a single two-sided message
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,std::size_t,typename std::decay<Args>::type...>::value),
+             class Result = invoke_result_t<typename std::decay<Function>::type,std::size_t,typename std::decay<Args>::type...>,
+             __REQUIRES(!std::is_void<Result>::value)
+            >
+    std::future<std::vector<Result>>
+      bulk_twoway_execute(Function&& f, std::size_t shape, Args&&... args) const
+    {
+      std::shared_ptr<bulk_continuation<Result>> continuation = std::make_shared<bulk_continuation<Result>>();
+
+      std::size_t first_node = next_node_index();
+
+      for(std::size_t partition = 0; partition < num_partitions(shape); ++partition)
+      {
+        std::size_t node = nodes_[(first_node + partition) % nodes_.size()];
+
+        continuation->partitions.emplace_back(context().two_sided_execute(node,
+          &bulk_invoke_and_collect<Result,typename std::decay<Function>::type,typename std::decay<Args>::type...>,
+          f, partition_begin(shape, partition), partition_begin(shape, partition + 1), args...
+        ));
+      }
+
+      std::future<std::vector<Result>> result = continuation->promise.get_future();
+
+      context().add_continuation([continuation]
+      {
+        return (*continuation)();
+      });
+
+      return result;
+    }
+
+    // the number of partitions a bulk submission of shape is divided into
+    inline std::size_t num_partitions(std::size_t shape) const
+    {
+      return shape < nodes_.size() ? shape : nodes_.size();
+    }
+
+    // returns the first index of a partition of a bulk submission of shape
+    // partitions differ in size by at most one
+    inline std::size_t partition_begin(std::size_t shape, std::size_t partition) const
+    {
+      std::size_t n = num_partitions(shape);
+      std::size_t size = shape / n;
+      std::size_t remainder = shape % n;
+
+      return partition * size + (partition < remainder ? partition : remainder);
+    }
+
+  private:
+    inline static std::vector<std::size_t> node_range(std::size_t first, std::size_t last)
+    {
+      std::vector<std::size_t> result;
+      for(std::size_t node = first; node < last; ++node)
+      {
+        result.push_back(node);
+      }
+
+      return result;
+    }
+
+    inline std::size_t next_node_index() const
+    {
+      return next_->fetch_add(1, std::memory_order_relaxed) % nodes_.size();
+    }
+
+    inline std::size_t next_node() const
+    {
+      return nodes_[next_node_index()];
+    }
+
+    // ties are broken by starting the search at the round-robin position
+    inline std::size_t least_outstanding_node() const
+    {
+      std::size_t first = next_node_index();
+
+      std::size_t result = nodes_[first];
+      std::size_t fewest = context().outstanding(result);
+
+      for(std::size_t i = 1; i < nodes_.size() && fewest > 0; ++i)
+      {
+        std::size_t node = nodes_[(first + i) % nodes_.size()];
+        std::size_t outstanding = context().outstanding(node);
+
+        if(outstanding < fewest)
+        {
+          result = node;
+          fewest = outstanding;
+        }
+      }
+
+      return result;
+    }
+
+    template<class T, class = decltype(std::hash<T>()(std::declval<const T&>()))>
+    static std::size_t hash_key(const T& key, int)
+    {
+      return std::hash<T>()(key);
+    }
+
+    // every submitted argument is serializable, so a key without a std::hash is hashed by its serialization
+    // equal keys serialize alike, except unordered containers, whose elements may be in different orders
+    template<class T>
+    static std::size_t hash_key(const T& key, long)
+    {
+      return std::hash<std::string>()(to_string(key));
+    }
+
+    inline static std::size_t hash_first()
+    {
+      throw std::runtime_error("cluster_executor: key_affinity requires a first argument.");
+    }
+
+    template<class Arg, class... Args>
+    static std::size_t hash_first(const Arg& key, const Args&...)
+    {
+      return hash_key(key, 0);
+    }
+
+    template<class Function, class... Args>
+    static void bulk_invoke(Function f, std::size_t begin, std::size_t end, Args... args)
+    {
+      for(std::size_t i = begin; i < end; ++i)
+      {
+        f(i, args...);
+      }
+    }
+
+    template<class Result, class Function, class... Args>
+    static std::vector<Result> bulk_invoke_and_collect(Function f, std::size_t begin, std::size_t end, Args... args)
+    {
+      std::vector<Result> result;
+      result.reserve(end - begin);
+
+      for(std::size_t i = begin; i < end; ++i)
+      {
+        result.push_back(f(i, args...));
+      }
+
+      return result;
+    }
+
+    // the polling thread calls a bulk_continuation until every partition's reply has arrived
+    template<class Result>
+    struct bulk_continuation
+    {
+      std::vector<std::future<std::vector<Result>>> partitions;
+      std::promise<std::vector<Result>> promise;
+
+      bool operator()()
+      {
+        for(std::future<std::vector<Result>>& partition : partitions)
+        {
+          if(partition.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+        }
+
+        try
+        {
+          std::vector<Result> result;
+          for(std::future<std::vector<Result>>& partition : partitions)
+          {
+            std::vector<Result> partial = partition.get();
+            result.insert(result.end(), std::make_move_iterator(partial.begin()), std::make_move_iterator(partial.end()));
+          }
+
+          promise.set_value(std::move(result));
+        }
+        catch(...)
+        {
+          promise.set_exception(std::current_exception());
+        }
+
+        return true;
+      }
+    };
+
+    std::vector<std::size_t> nodes_;
+    load_balancing_policy policy_;
+    std::shared_ptr<std::atomic<std::size_t>> next_;
+};
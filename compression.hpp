@@ -0,0 +1,405 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+
+#ifdef ACTIVE_MESSAGE_ENABLE_LZ4
+#include <lz4.h>
+#endif
+
+
+// define ACTIVE_MESSAGE_ENABLE_LZ4 and link with -llz4 to make the LZ4 library's codec available
+// otherwise, the built-in codec, which writes the same block format, is the only one
+enum class compression_codec : std::uint16_t
+{
+  none = 0,
+  lz   = 1, // built-in
+  lz4  = 2  // LZ4 library
+};
+
+
+// parses the names of compression_codec's enumerators, as used by ACTIVE_MESSAGE_COMPRESSION_CODEC
+inline compression_codec parse_compression_codec(const char* name)
+{
+  if(std::strcmp(name, "none") == 0) return compression_codec::none;
+  if(std::strcmp(name, "lz") == 0)   return compression_codec::lz;
+  if(std::strcmp(name, "lz4") == 0)
+  {
+#ifdef ACTIVE_MESSAGE_ENABLE_LZ4
+    return compression_codec::lz4;
+#else
+    throw std::runtime_error("parse_compression_codec(): lz4 requires ACTIVE_MESSAGE_ENABLE_LZ4");
+#endif
+  }
+
+  throw std::runtime_error(std::string("parse_compression_codec(): Unknown codec ") + name);
+}
+
+
+// the built-in codec is a greedy LZ77 compressor which writes the LZ4 block format:
+// a sequence of (token, literals, offset, match) where the token's high and low nibbles hold the
+// literal and match lengths, lengths of 15 or more continue in bytes of 255, and the final sequence has no match
+namespace lz
+{
+
+
+const std::size_t min_match = 4;
+
+// the format requires that the last match begin at least 12 bytes before the end of the input
+// and that the last 5 bytes be literals
+const std::size_t match_limit = 12;
+const std::size_t last_literals = 5;
+
+const std::size_t max_offset = 65535;
+
+const int hash_log = 12;
+
+
+inline std::size_t max_compressed_size(std::size_t n)
+{
+  return n + n / 255 + 16;
+}
+
+
+inline std::uint32_t read32(const char* p)
+{
+  std::uint32_t result;
+  std::memcpy(&result, p, sizeof(result));
+  return result;
+}
+
+
+inline std::uint64_t read64(const char* p)
+{
+  std::uint64_t result;
+  std::memcpy(&result, p, sizeof(result));
+  return result;
+}
+
+
+inline std::uint32_t hash(std::uint32_t sequence)
+{
+  return (sequence * 2654435761u) >> (32 - hash_log);
+}
+
+
+inline char* write_length(char* out, std::size_t length)
+{
+  for(; length >= 255; length -= 255)
+  {
+    *out++ = static_cast<char>(255);
+  }
+
+  *out++ = static_cast<char>(length);
+  return out;
+}
+
+
+inline char* write_sequence(char* out, const char* literals, std::size_t num_literals, std::size_t offset, std::size_t match_length)
+{
+  char* token = out++;
+
+  std::size_t literal_nibble = num_literals < 15 ? num_literals : 15;
+  if(num_literals >= 15)
+  {
+    out = write_length(out, num_literals - 15);
+  }
+
+  std::memcpy(out, literals, num_literals);
+  out += num_literals;
+
+  std::size_t match_nibble = 0;
+  if(match_length > 0)
+  {
+    out[0] = static_cast<char>(offset & 0xff);
+    out[1] = static_cast<char>(offset >> 8);
+    out += 2;
+
+    std::size_t length = match_length - min_match;
+    match_nibble = length < 15 ? length : 15;
+    if(length >= 15)
+    {
+      out = write_length(out, length - 15);
+    }
+  }
+
+  *token = static_cast<char>((literal_nibble << 4) | match_nibble);
+  return out;
+}
+
+
+// compresses n bytes from source into result, which must hold max_compressed_size(n) bytes
+// returns the size of the compressed bytes
+inline std::size_t compress(const char* source, std::size_t n, char* result)
+{
+  char* out = result;
+  std::size_t anchor = 0;
+
+  if(n > match_limit)
+  {
+    // the position of the most recent occurrence of each hashed four-byte sequence
+    std::uint32_t table[1 << hash_log] = {};
+
+    // the longer we go without finding a match, the further we skip ahead, so incompressible input is cheap
+    std::size_t num_misses = 0;
+
+    std::size_t position = 0;
+    while(position + match_limit <= n)
+    {
+      std::uint32_t sequence = read32(source + position);
+      std::uint32_t& entry = table[hash(sequence)];
+      std::size_t candidate = entry;
+      entry = static_cast<std::uint32_t>(position);
+
+      if(candidate < position && position - candidate <= max_offset && read32(source + candidate) == sequence)
+      {
+        // extend the match eight bytes at a time, then byte by byte
+        std::size_t length = min_match;
+        std::size_t max_length = n - last_literals - position;
+
+        while(length + 8 <= max_length && read64(source + candidate + length) == read64(source + position + length))
+        {
+          length += 8;
+        }
+
+        while(length < max_length && source[candidate + length] == source[position + length])
+        {
+          ++length;
+        }
+
+        out = write_sequence(out, source + anchor, position - anchor, position - candidate, length);
+
+        position += length;
+        anchor = position;
+        num_misses = 0;
+      }
+      else
+      {
+        position += 1 + (num_misses++ >> 6);
+      }
+    }
+  }
+
+  out = write_sequence(out, source + anchor, n - anchor, 0, 0);
+
+  return out - result;
+}
+
+
+inline std::size_t read_length(const unsigned char*& in, const unsigned char* end)
+{
+  std::size_t result = 0;
+  unsigned char byte = 255;
+
+  while(byte == 255)
+  {
+    if(in == end)
+    {
+      throw std::runtime_error("lz::decompress(): Truncated input.");
+    }
+
+    byte = *in++;
+    result += byte;
+  }
+
+  return result;
+}
+
+
+// decompresses n bytes from source into exactly decompressed_size bytes at result
+inline void decompress(const char* source, std::size_t n, char* result, std::size_t decompressed_size)
+{
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(source);
+  const unsigned char* in_end = in + n;
+  char* out = result;
+  char* out_end = result + decompressed_size;
+
+  while(true)
+  {
+    if(in == in_end)
+    {
+      throw std::runtime_error("lz::decompress(): Truncated input.");
+    }
+
+    unsigned char token = *in++;
+
+    std::size_t num_literals = token >> 4;
+    if(num_literals == 15)
+    {
+      num_literals += read_length(in, in_end);
+    }
+
+    if(num_literals > static_cast<std::size_t>(in_end - in) || num_literals > static_cast<std::size_t>(out_end - out))
+    {
+      throw std::runtime_error("lz::decompress(): Literals overrun the buffer.");
+    }
+
+    std::memcpy(out, in, num_literals);
+    in += num_literals;
+    out += num_literals;
+
+    // the final sequence has no match
+    if(in == in_end) break;
+
+    if(in_end - in < 2)
+    {
+      throw std::runtime_error("lz::decompress(): Truncated input.");
+    }
+
+    std::size_t offset = in[0] | (static_cast<std::size_t>(in[1]) << 8);
+    in += 2;
+
+    std::size_t length = token & 15;
+    if(length == 15)
+    {
+      length += read_length(in, in_end);
+    }
+    length += min_match;
+
+    if(offset == 0 || offset > static_cast<std::size_t>(out - result) || length > static_cast<std::size_t>(out_end - out))
+    {
+      throw std::runtime_error("lz::decompress(): Match overruns the buffer.");
+    }
+
+    // a match may overlap its own output, so copy it forward
+    // eight bytes at a time when the chunks don't overlap, otherwise byte by byte
+    const char* match = out - offset;
+    char* match_end = out + length;
+
+    if(offset >= 8)
+    {
+      for(; match_end - out >= 8; out += 8, match += 8)
+      {
+        std::memcpy(out, match, 8);
+      }
+    }
+
+    while(out < match_end)
+    {
+      *out++ = *match++;
+    }
+  }
+
+  if(out != out_end)
+  {
+    throw std::runtime_error("lz::decompress(): Unexpected decompressed size.");
+  }
+}
+
+
+} // end lz
+
+
+// returns the number of bytes compress() may produce from n bytes
+inline std::size_t max_compressed_size(compression_codec codec, std::size_t n)
+{
+#ifdef ACTIVE_MESSAGE_ENABLE_LZ4
+  if(codec == compression_codec::lz4)
+  {
+    return LZ4_compressBound(static_cast<int>(n));
+  }
+#endif
+
+  return codec == compression_codec::none ? n : lz::max_compressed_size(n);
+}
+
+
+// compresses n bytes from source into result, which must hold max_compressed_size(codec, n) bytes
+// returns the size of the compressed bytes
+inline std::size_t compress(compression_codec codec, const char* source, std::size_t n, char* result)
+{
+  switch(codec)
+  {
+    case compression_codec::none:
+    {
+      std::memcpy(result, source, n);
+      return n;
+    }
+
+    case compression_codec::lz:
+    {
+      return lz::compress(source, n, result);
+    }
+
+    case compression_codec::lz4:
+    {
+#ifdef ACTIVE_MESSAGE_ENABLE_LZ4
+      return LZ4_compress_default(source, result, static_cast<int>(n), LZ4_compressBound(static_cast<int>(n)));
+#else
+      break;
+#endif
+    }
+  }
+
+  throw std::runtime_error("compress(): Unsupported codec.");
+}
+
+
+// decompresses n bytes from source into exactly decompressed_size bytes at result
+// throws if the compressed bytes are malformed
+inline void decompress(compression_codec codec, const char* source, std::size_t n, char* result, std::size_t decompressed_size)
+{
+  switch(codec)
+  {
+    case compression_codec::none:
+    {
+      if(n != decompressed_size)
+      {
+        throw std::runtime_error("decompress(): Unexpected decompressed size.");
+      }
+
+      std::memcpy(result, source, n);
+      return;
+    }
+
+    case compression_codec::lz:
+    {
+      lz::decompress(source, n, result, decompressed_size);
+      return;
+    }
+
+    case compression_codec::lz4:
+    {
+#ifdef ACTIVE_MESSAGE_ENABLE_LZ4
+      if(LZ4_decompress_safe(source, result, static_cast<int>(n), static_cast<int>(decompressed_size)) != static_cast<int>(decompressed_size))
+      {
+        throw std::runtime_error("decompress(): Malformed LZ4 block.");
+      }
+      return;
+#else
+      break;
+#endif
+    }
+  }
+
+  throw std::runtime_error("decompress(): Unsupported codec.");
+}
@@ -0,0 +1,190 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// measures the payload size at which compressing messages pays for itself
+// it doesn't use shmem, so it builds with any compiler
+//
+// $ g++ -O3 -std=c++11 compression_benchmark.cpp -o compression_benchmark
+// $ ./compression_benchmark [link bandwidth in GB/s, default 12.5]
+//
+// for each payload and size, it reports the compression ratio, the codec's throughput, and the
+// break-even bandwidth: compression makes a message arrive sooner on links slower than that bandwidth,
+// because the time saved on the wire exceeds the time spent compressing and decompressing
+//
+// define ACTIVE_MESSAGE_ENABLE_LZ4 and link with -llz4 to compare the LZ4 library's codec
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "compression.hpp"
+#include "serialization.hpp"
+
+
+// arguments formatted by to_string: a vector of records, serialized element by element
+std::string text_payload(std::size_t size)
+{
+  std::vector<std::tuple<int, double, std::string>> records;
+  std::mt19937 rng(13);
+
+  // each record takes at least 16 bytes
+  for(std::size_t i = 0; i < size / 16 + 1; ++i)
+  {
+    records.emplace_back(static_cast<int>(i), 0.5 * (rng() % 1000), "record-" + std::to_string(rng() % 100));
+  }
+
+  std::string result = to_string(records);
+
+  result.resize(size);
+  return result;
+}
+
+// a block of smoothly varying doubles, serialized as raw bytes
+std::string binary_payload(std::size_t size)
+{
+  std::vector<double> samples(size / sizeof(double) + 1);
+  for(std::size_t i = 0; i < samples.size(); ++i)
+  {
+    samples[i] = std::round(1000 * std::sin(i / 64.0)) / 1000;
+  }
+
+  std::string result = to_string(samples);
+  result.resize(size);
+  return result;
+}
+
+// incompressible bytes
+std::string random_payload(std::size_t size)
+{
+  std::mt19937 rng(7);
+  std::string result(size, 0);
+  for(char& c : result)
+  {
+    c = static_cast<char>(rng());
+  }
+
+  return result;
+}
+
+
+// returns the average number of seconds f takes
+template<class Function>
+double seconds_per_call(Function f)
+{
+  using clock = std::chrono::steady_clock;
+
+  // repeat for at least 50 ms
+  std::size_t num_trials = 0;
+  clock::time_point start = clock::now();
+  clock::duration elapsed;
+  do
+  {
+    f();
+    ++num_trials;
+    elapsed = clock::now() - start;
+  }
+  while(elapsed < std::chrono::milliseconds(50));
+
+  return std::chrono::duration<double>(elapsed).count() / num_trials;
+}
+
+
+void measure(const char* payload_name, const std::string& payload, compression_codec codec, const char* codec_name, double bandwidth)
+{
+  std::string compressed(max_compressed_size(codec, payload.size()), 0);
+  std::string decompressed(payload.size(), 0);
+  std::size_t compressed_size = 0;
+
+  double compress_seconds = seconds_per_call([&]
+  {
+    compressed_size = compress(codec, payload.data(), payload.size(), &compressed[0]);
+  });
+
+  double decompress_seconds = seconds_per_call([&]
+  {
+    decompress(codec, compressed.data(), compressed_size, &decompressed[0], decompressed.size());
+  });
+
+  if(decompressed != payload)
+  {
+    throw std::runtime_error("measure(): Round trip failed.");
+  }
+
+  double saved_bytes = static_cast<double>(payload.size()) - static_cast<double>(compressed_size);
+  double codec_seconds = compress_seconds + decompress_seconds;
+
+  // compression pays off when codec_seconds < saved_bytes / bandwidth
+  double break_even = saved_bytes > 0 ? saved_bytes / codec_seconds / 1e9 : 0;
+
+  std::cout << std::setw(8) << payload_name
+            << std::setw(6) << codec_name
+            << std::setw(10) << payload.size()
+            << std::setw(10) << std::fixed << std::setprecision(2) << static_cast<double>(payload.size()) / compressed_size
+            << std::setw(12) << std::setprecision(0) << payload.size() / compress_seconds / 1e6
+            << std::setw(12) << payload.size() / decompress_seconds / 1e6
+            << std::setw(12) << std::setprecision(2) << break_even
+            << std::setw(6) << (break_even > bandwidth ? "yes" : "no")
+            << std::endl;
+}
+
+
+int main(int argc, char** argv)
+{
+  double bandwidth = argc > 1 ? std::atof(argv[1]) : 12.5;
+
+  std::vector<std::pair<compression_codec, const char*>> codecs = {{compression_codec::lz, "lz"}};
+#ifdef ACTIVE_MESSAGE_ENABLE_LZ4
+  codecs.emplace_back(compression_codec::lz4, "lz4");
+#endif
+
+  std::cout << std::setw(8) << "payload"
+            << std::setw(6) << "codec"
+            << std::setw(10) << "bytes"
+            << std::setw(10) << "ratio"
+            << std::setw(12) << "comp MB/s"
+            << std::setw(12) << "decomp MB/s"
+            << std::setw(12) << "break GB/s"
+            << std::setw(6) << "wins"
+            << std::endl;
+
+  for(std::size_t size = 256; size <= (1 << 20); size *= 4)
+  {
+    for(const auto& codec : codecs)
+    {
+      measure("text",   text_payload(size),   codec.first, codec.second, bandwidth);
+      measure("binary", binary_payload(size), codec.first, codec.second, bandwidth);
+      measure("random", random_payload(size), codec.first, codec.second, bandwidth);
+    }
+  }
+
+  std::cout << "wins: compression pays off on a " << bandwidth << " GB/s link" << std::endl;
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// $ ./openshmem-am-root/bin/oshc++ -std=c++11 continuation.cpp 
+// $ ./openshmem-am-root/bin/oshrun ./a.out -n 2
+// PE 0: Waiting on the continuation
+// PE 1: Hello, world!
+// PE 0: Continuation satisfied with result 26
+// PE 0: Squares: 0 1 4 9
+
+#include <iostream>
+#include <future>
+#include <vector>
+#include <cassert>
+
+#include "remote_executor.hpp"
+
+
+int hello_world()
+{
+  std::cout << "PE " << shmem_my_pe() << ": Hello, world!" << std::endl;
+
+  return 13;
+}
+
+int twice(int x)
+{
+  return 2 * x;
+}
+
+int square(std::size_t i)
+{
+  return static_cast<int>(i * i);
+}
+
+int main()
+{
+  if(shmem_my_pe() == 0)
+  {
+    remote_executor exec(1);
+    std::future<int> future = exec.twoway_execute(hello_world);
+
+    // once future is ready, double its result on node 1
+    // no thread waits on future: the polling thread sends the request when it becomes ready
+    std::future<int> doubled = exec.then_execute(twice, future);
+
+    std::cout << "PE 0: Waiting on the continuation" << std::endl;
+    int result = doubled.get();
+    assert(result == 26);
+
+    std::cout << "PE 0: Continuation satisfied with result " << result << std::endl;
+
+    // execute square(i) on node 1 for each i in [0, 4), all in a single message
+    std::vector<int> squares = exec.bulk_twoway_execute(square, 4).get();
+    assert(squares.size() == 4);
+
+    std::cout << "PE 0: Squares:";
+    for(int s : squares)
+    {
+      std::cout << " " << s;
+    }
+    std::cout << std::endl;
+  }
+
+  shmem_barrier_all();
+}
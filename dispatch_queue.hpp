@@ -0,0 +1,113 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <utility>
+
+
+// dispatch_queue is a FIFO of work which a node has received but not yet executed
+// any number of threads may push and run items concurrently; items begin in FIFO order,
+// but when several threads run items, an item may finish before an item which began earlier
+class dispatch_queue
+{
+  public:
+    using item_type = std::function<void()>;
+
+    inline void push(item_type item)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        items_.emplace_back(std::move(item));
+      }
+
+      item_pushed_.notify_one();
+    }
+
+    // executes the oldest item, if there is one
+    // returns false if the queue was empty
+    inline bool run_one()
+    {
+      item_type item;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if(items_.empty()) return false;
+
+        item = std::move(items_.front());
+        items_.pop_front();
+      }
+
+      item();
+      return true;
+    }
+
+    // like run_one(), but if the queue is empty, waits up to timeout for an item to arrive
+    template<class Rep, class Period>
+    bool run_one_for(const std::chrono::duration<Rep,Period>& timeout)
+    {
+      item_type item;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        if(!item_pushed_.wait_for(lock, timeout, [this]{ return !items_.empty(); }))
+        {
+          return false;
+        }
+
+        item = std::move(items_.front());
+        items_.pop_front();
+      }
+
+      item();
+      return true;
+    }
+
+    inline std::size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return items_.size();
+    }
+
+    inline bool empty() const
+    {
+      return size() == 0;
+    }
+
+  private:
+    mutable std::mutex mutex_;
+    std::condition_variable item_pushed_;
+    std::deque<item_type> items_;
+};
+
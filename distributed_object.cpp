@@ -0,0 +1,87 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// $ ./openshmem-am-root/bin/oshc++ -std=c++11 distributed_object.cpp 
+// $ ./openshmem-am-root/bin/oshrun ./a.out -n 2
+// PE 0: "hello" is stored in shard 1 as "world"
+// PE 1: "hello" is stored in shard 1 as "world"
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <cassert>
+
+#include "distributed_object.hpp"
+
+
+// each node owns one shard of the cache
+class cache_shard
+{
+  public:
+    void insert(std::string key, std::string value)
+    {
+      entries_[key] = value;
+    }
+
+    std::string lookup(const std::string& key) const
+    {
+      auto found = entries_.find(key);
+      return found == entries_.end() ? std::string() : found->second;
+    }
+
+  private:
+    std::unordered_map<std::string, std::string> entries_;
+};
+
+std::size_t shard_of(const std::string& key)
+{
+  return std::hash<std::string>()(key) % shmem_n_pes();
+}
+
+int main()
+{
+  // every node constructs its shard collectively
+  distributed_object<cache_shard> cache;
+
+  shmem_barrier_all();
+
+  if(shmem_my_pe() == 0)
+  {
+    cache.execute_on(shard_of("hello"), &cache_shard::insert, "hello", "world");
+  }
+
+  system_context().wait_for_all();
+  shmem_barrier_all();
+
+  std::size_t shard = shard_of("hello");
+  std::string value = cache.invoke_on(shard, &cache_shard::lookup, "hello").get();
+  assert(value == "world");
+
+  std::cout << "PE " << shmem_my_pe() << ": \"hello\" is stored in shard " << shard << " as \"" << value << "\"" << std::endl;
+
+  shmem_barrier_all();
+}
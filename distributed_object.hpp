@@ -0,0 +1,220 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <future>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+
+#include "serialization.hpp"
+#include "execution_context.hpp"
+
+
+// define ACTIVE_MESSAGE_DISTRIBUTED_OBJECT_CAPACITY to change the maximum number of distributed_objects
+// which may exist on a node at once
+#ifndef ACTIVE_MESSAGE_DISTRIBUTED_OBJECT_CAPACITY
+#define ACTIVE_MESSAGE_DISTRIBUTED_OBJECT_CAPACITY 1024
+#endif
+
+
+// distributed_object_registry maps the id of each distributed_object to its node-local instance
+// ids are assigned lowest-free-first, so nodes which construct and destroy their distributed_objects
+// in the same order agree on every object's id
+class distributed_object_registry
+{
+  public:
+    static const std::size_t capacity = ACTIVE_MESSAGE_DISTRIBUTED_OBJECT_CAPACITY;
+
+    inline static std::size_t insert(void* object)
+    {
+      std::lock_guard<std::mutex> lock(mutex());
+
+      for(std::size_t id = 0; id < capacity; ++id)
+      {
+        if(!table()[id].load(std::memory_order_relaxed))
+        {
+          table()[id].store(object, std::memory_order_release);
+          return id;
+        }
+      }
+
+      throw std::runtime_error("distributed_object_registry::insert(): Too many distributed_objects.");
+    }
+
+    inline static void erase(std::size_t id)
+    {
+      std::lock_guard<std::mutex> lock(mutex());
+      table()[id].store(nullptr, std::memory_order_release);
+    }
+
+    // lookup is a single atomic load: it neither locks nor allocates
+    inline static void* find(std::size_t id)
+    {
+      return id < capacity ? table()[id].load(std::memory_order_acquire) : nullptr;
+    }
+
+  private:
+    inline static std::mutex& mutex()
+    {
+      static std::mutex result;
+      return result;
+    }
+
+    inline static std::atomic<void*>* table()
+    {
+      // static storage is zero-initialized, so every entry begins null
+      static std::atomic<void*> result[capacity];
+      return result;
+    }
+};
+
+
+// distributed_object<T> is a collection of T objects, one per node, which are addressed by a common id
+// invoke_on() and execute_on() call a member function of the instance on a particular node
+// only the object's id, the member function pointer, and the arguments are transmitted
+//
+// constructing and destroying a distributed_object is a collective operation:
+// every node must construct and destroy its distributed_objects in the same order
+// XXX a message may arrive at a node before that node has constructed its instance,
+//     so nodes should synchronize (e.g., with shmem_barrier_all()) before invoking each other's instances
+template<class T>
+class distributed_object
+{
+  public:
+    using element_type = T;
+
+    template<class... Args,
+             __REQUIRES(std::is_constructible<T,Args&&...>::value)
+            >
+    explicit distributed_object(Args&&... args)
+      : local_(std::forward<Args>(args)...),
+        id_(distributed_object_registry::insert(&local_))
+    {}
+
+    distributed_object(const distributed_object&) = delete;
+    distributed_object& operator=(const distributed_object&) = delete;
+
+    inline ~distributed_object()
+    {
+      distributed_object_registry::erase(id_);
+    }
+
+    inline std::size_t id() const
+    {
+      return id_;
+    }
+
+    // returns this node's instance
+    inline T& local()
+    {
+      return local_;
+    }
+
+    inline const T& local() const
+    {
+      return local_;
+    }
+
+    // calls (instance.*method)(args...) on the given node's instance and returns a future for its result
+    template<class Result, class... Params, class... Args,
+             __REQUIRES(sizeof...(Params) == sizeof...(Args))
+            >
+    std::future<Result> invoke_on(std::size_t node, Result (T::*method)(Params...), Args&&... args) const
+    {
+      return system_context().two_sided_execute(node, &invoke_local<Result, Result (T::*)(Params...), typename std::decay<Params>::type...>, id_, method, parameter_t<Params>(std::forward<Args>(args))...);
+    }
+
+    template<class Result, class... Params, class... Args,
+             __REQUIRES(sizeof...(Params) == sizeof...(Args))
+            >
+    std::future<Result> invoke_on(std::size_t node, Result (T::*method)(Params...) const, Args&&... args) const
+    {
+      return system_context().two_sided_execute(node, &invoke_local<Result, Result (T::*)(Params...) const, typename std::decay<Params>::type...>, id_, method, parameter_t<Params>(std::forward<Args>(args))...);
+    }
+
+    // calls (instance.*method)(args...) on the given node's instance and discards its result
+    template<class Result, class... Params, class... Args,
+             __REQUIRES(sizeof...(Params) == sizeof...(Args))
+            >
+    submission_status execute_on(std::size_t node, Result (T::*method)(Params...), Args&&... args) const
+    {
+      return system_context().one_sided_execute(node, &execute_local<Result (T::*)(Params...), typename std::decay<Params>::type...>, id_, method, parameter_t<Params>(std::forward<Args>(args))...);
+    }
+
+    template<class Result, class... Params, class... Args,
+             __REQUIRES(sizeof...(Params) == sizeof...(Args))
+            >
+    submission_status execute_on(std::size_t node, Result (T::*method)(Params...) const, Args&&... args) const
+    {
+      return system_context().one_sided_execute(node, &execute_local<Result (T::*)(Params...) const, typename std::decay<Params>::type...>, id_, method, parameter_t<Params>(std::forward<Args>(args))...);
+    }
+
+  private:
+    // arguments are converted to the method's parameter types before they are serialized
+    // so that, e.g., a string literal travels as a std::string rather than as a pointer
+    template<class Param>
+    using parameter_t = typename std::decay<Param>::type;
+
+    // this function is what actually travels in a two-sided message
+    // it finds the receiving node's instance and calls the method on it
+    // if there is no instance, the exception fails the caller's future with a remote_error
+    template<class Result, class Method, class... Args>
+    static Result invoke_local(std::size_t id, Method method, Args... args)
+    {
+      T* self = static_cast<T*>(distributed_object_registry::find(id));
+      if(!self)
+      {
+        throw std::runtime_error("distributed_object::invoke_local(): No instance with this id exists on this node.");
+      }
+
+      return (self->*method)(std::move(args)...);
+    }
+
+    // one-sided messages have no reply to carry an error, so a call to a missing instance is reported and dropped
+    // rather than thrown from the handler
+    template<class Method, class... Args>
+    static void execute_local(std::size_t id, Method method, Args... args)
+    {
+      T* self = static_cast<T*>(distributed_object_registry::find(id));
+      if(!self)
+      {
+        std::cerr << "distributed_object::execute_local(): Dropped a call to instance " << id << ", which doesn't exist on node " << shmem_my_pe() << "." << std::endl;
+        return;
+      }
+
+      (self->*method)(std::move(args)...);
+    }
+
+    T local_;
+    std::size_t id_;
+};
+
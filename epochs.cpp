@@ -0,0 +1,129 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// $ ./openshmem-am-root/bin/oshc++ -std=c++11 epochs.cpp 
+// $ ./openshmem-am-root/bin/oshrun ./a.out -n 2
+// PE 0: Node 1 executed 10 messages
+// PE 0: The epoch's 10 messages were executed
+// PE 0: Quiet after 30 messages
+// PE 0: 16 epochs alive at once: OK
+
+#include <iostream>
+#include <future>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <atomic>
+#include <cassert>
+
+#include "execution_context.hpp"
+
+
+std::atomic<int> num_executed{0};
+
+void count()
+{
+  ++num_executed;
+}
+
+int executed()
+{
+  return num_executed;
+}
+
+int main()
+{
+  execution_context& ctx = system_context();
+
+  if(shmem_my_pe() == 0)
+  {
+    // wait_for(node) waits only for the messages sent to node
+    for(int i = 0; i < 10; ++i)
+    {
+      ctx.one_sided_execute(1, count);
+    }
+
+    ctx.wait_for(1);
+    assert(ctx.outstanding(1) == 0);
+    std::cout << "PE 0: Node 1 executed " << ctx.two_sided_execute(1, executed).get() << " messages" << std::endl;
+
+    // an epoch waits only for the messages its thread sent while it was alive
+    {
+      execution_context::epoch phase;
+
+      for(int i = 0; i < 10; ++i)
+      {
+        ctx.one_sided_execute(1, count);
+      }
+
+      phase.wait();
+    }
+
+    int after_epoch = ctx.two_sided_execute(1, executed).get();
+    assert(after_epoch == 20);
+    std::cout << "PE 0: The epoch's " << after_epoch - 10 << " messages were executed" << std::endl;
+
+    // quiet_async() doesn't block the calling thread while it waits
+    for(int i = 0; i < 10; ++i)
+    {
+      ctx.one_sided_execute(1, count);
+    }
+
+    std::future<void> quiet = ctx.quiet_async();
+    quiet.get();
+
+    int after_quiet = ctx.two_sided_execute(1, executed).get();
+    assert(after_quiet == 30);
+    std::cout << "PE 0: Quiet after " << after_quiet << " messages" << std::endl;
+
+    // every one of the ACTIVE_MESSAGE_EPOCH_CAPACITY epochs may be alive at once, and one more is too many
+    {
+      std::vector<std::unique_ptr<execution_context::epoch>> epochs;
+      for(int i = 0; i < ACTIVE_MESSAGE_EPOCH_CAPACITY; ++i)
+      {
+        epochs.emplace_back(new execution_context::epoch);
+      }
+
+      try
+      {
+        execution_context::epoch one_too_many;
+        assert(false);
+      }
+      catch(const std::runtime_error&)
+      {
+        std::cout << "PE 0: " << epochs.size() << " epochs alive at once: OK" << std::endl;
+      }
+
+      // destroy the epochs innermost first, which restores each enclosing epoch in turn
+      while(!epochs.empty())
+      {
+        epochs.pop_back();
+      }
+    }
+  }
+
+  shmem_barrier_all();
+}
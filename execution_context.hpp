@@ -34,184 +34,1957 @@
 #include <type_traits>
 #include <thread>
 #include <atomic>
+#include <future>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <sstream>
+#include <functional>
+#include <memory>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
 
 #include "active_message.hpp"
+#include "statistics.hpp"
+#include "trace.hpp"
+#include "staging_pool.hpp"
+#include "flow_control.hpp"
+#include "dispatch_queue.hpp"
+#include "timer_wheel.hpp"
+#include "cancellation.hpp"
+#include "topology.hpp"
+#include "compression.hpp"
+#include "arena.hpp"
+#include "handler_table.hpp"
+
+
+// define ACTIVE_MESSAGE_INLINE_MESSAGE_CAPACITY to change the size of the messages
+// which are serialized and sent without allocating
+#ifndef ACTIVE_MESSAGE_INLINE_MESSAGE_CAPACITY
+#define ACTIVE_MESSAGE_INLINE_MESSAGE_CAPACITY 256
+#endif
+
+
+// define ACTIVE_MESSAGE_EPOCH_CAPACITY to change the number of epochs which may be alive at once on each node
+// every node keeps a completion counter for each epoch of each node
+#ifndef ACTIVE_MESSAGE_EPOCH_CAPACITY
+#define ACTIVE_MESSAGE_EPOCH_CAPACITY 16
+#endif
+
+
+// high-priority messages are executed by the handler which receives them
+// normal-priority messages are queued and executed by the progress threads, or by the polling thread between polls,
+// so a high-priority message waits for at most one normal-priority message to finish
+enum class message_priority : std::uint16_t
+{
+  normal = 0,
+  high   = 1
+};
+
+
+// the exception delivered through a future whose request threw on the node which executed it
+// only the original exception's what() crosses the network
+class remote_error : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
 
 class execution_context
 {
   public:
     inline execution_context()
-      : continue_polling_{true}
+      : continue_polling_{true},
+        flow_control_policy_{initial_flow_control_policy()},
+        num_spilled_{0},
+        num_continuations_{0}
+    {
+      // start shmem
+      shmem_init();
+
+      // allocate the anchor of the symmetric heap before any other symmetric object
+      symmetric_heap_base();
+
+      // allocate the symmetric memory used to stage large messages
+      rendezvous_pool();
+
+      // create the credit windows and the queues of messages which exceeded them
+      credits();
+      spilled_.resize(node_count());
+
+      // create the queue of normal-priority messages and the credits they will return
+      normal_lane();
+      returned_credits();
+
+      // count the two-sided requests each node has yet to answer
+      replies_outstanding();
+
+      // count the messages sent and executed in each epoch
+      epochs_sent();
+      epochs_completed();
+
+      // create the wheel which expires the promises of requests with deadlines
+      timers();
+
+      // create the table of registered handlers
+      handlers();
+
+      // register handlers
+      shmemx_am_attach(one_sided_request_handler_id_, one_sided_request_handler);
+      shmemx_am_attach(two_sided_request_handler_id_, two_sided_request_handler);
+      shmemx_am_attach(two_sided_reply_handler_id_,   two_sided_reply_handler);
+      shmemx_am_attach(rendezvous_handler_id_,        rendezvous_handler);
+      shmemx_am_attach(credit_handler_id_,            credit_handler);
+
+      // a node may send as soon as its constructor returns, so wait until every node can receive
+      shmem_barrier_all();
+
+      // choose where the polling thread and progress threads run
+      // each thread pins itself before it touches its per-thread statistics counters and trace ring,
+      // so the kernel's first-touch policy places those buffers on the thread's NUMA node
+      std::vector<std::vector<int>> cpus = progress_cpus(1 + num_progress_threads());
+
+      // begin executing normal-priority messages in parallel
+      for(std::size_t i = 0; i < num_progress_threads(); ++i)
+      {
+        std::vector<int> progress_thread_cpus = cpus[1 + i];
+
+        progress_threads_.emplace_back([this, progress_thread_cpus]
+        {
+          pin_this_thread(progress_thread_cpus);
+          on_handler_thread() = true;
+
+          while(continue_polling_)
+          {
+            normal_lane().run_one_for(std::chrono::milliseconds(30));
+          }
+        });
+      }
+
+      // begin polling
+      std::vector<int> polling_thread_cpus = cpus[0];
+
+      polling_thread_ = std::thread([this, polling_thread_cpus]
+      {
+        pin_this_thread(polling_thread_cpus);
+        on_handler_thread() = true;
+
+        while(continue_polling_)
+        {
+          poll();
+        }
+      });
+    }
+
+    inline ~execution_context()
+    {
+      continue_polling_ = false;
+
+      polling_thread_.join();
+
+      for(std::thread& progress_thread : progress_threads_)
+      {
+        progress_thread.join();
+      }
+
+      // dump this node's trace if the user asked for one
+      // a destructor mustn't throw, so a trace which can't be written is reported rather than thrown
+      if(const char* prefix = std::getenv("ACTIVE_MESSAGE_TRACE_PREFIX"))
+      {
+        try
+        {
+          dump_trace(prefix);
+        }
+        catch(const std::exception& e)
+        {
+          std::cerr << "execution_context: Couldn't dump trace: " << e.what() << std::endl;
+        }
+      }
+
+      // XXX note that we don't call shmem_finalize() because it may already have been shutdown
+    }
+
+    inline std::size_t node_count() const
+    {
+      return shmem_n_pes();
+    }
+
+    // returns this node's address of a symmetric object which every node allocates collectively before any other
+    // symmetric objects needn't have the same address on every node, but every node allocates them in the same order,
+    // so each lies at the same offset from this anchor on every node
+    inline static char* symmetric_heap_base()
+    {
+      static char* result = static_cast<char*>(shmem_malloc(1));
+      return result;
+    }
+    
+    inline void wait_for_all()
+    {
+      // wait for the polling thread to send the messages which exceeded their credit windows,
+      // to execute the messages this node sent to itself,
+      // and to finish the continuations waiting on this node's futures
+      while(num_spilled_.load() > 0 || num_local_messages_pending().load() > 0 || num_continuations_.load() > 0)
+      {
+        std::this_thread::yield();
+      }
+
+      shmemx_am_quiet();
+
+      // shmemx_am_quiet() only guarantees that the handlers have run, but normal-priority messages are executed
+      // after their handlers return, so also wait for every one-sided message to be acknowledged
+      // and for every two-sided request to be answered
+      while(!is_quiet())
+      {
+        std::this_thread::yield();
+      }
+    }
+
+    // returns a future which becomes ready once every message this node has sent has been executed,
+    // without blocking the calling thread as wait_for_all() does
+    // unlike wait_for_all(), this doesn't wait for other continuations, which may themselves be waiting on it
+    // steady traffic from other threads can delay it indefinitely; an epoch waits only for its own thread's messages
+    inline std::future<void> quiet_async()
+    {
+      std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+      std::future<void> result = promise->get_future();
+
+      add_continuation([this, promise]
+      {
+        if(!is_quiet())
+        {
+          return false;
+        }
+
+        promise->set_value();
+        return true;
+      });
+
+      return result;
+    }
+
+    // blocks until node has executed every message this node sent it,
+    // without waiting for the messages sent to other nodes
+    inline void wait_for(std::size_t node)
+    {
+      while(outstanding(node) > 0 || spilled(node) > 0)
+      {
+        std::this_thread::yield();
+      }
+    }
+
+    // an epoch tracks the messages a thread sends during a phase, such as a BSP superstep,
+    // so that the thread can wait for them without also waiting for other threads' messages
+    // the messages a thread sends while an epoch it created is alive belong to that epoch
+    // epochs may nest, and a thread's messages belong only to its innermost epoch
+    class epoch
+    {
+      public:
+        inline epoch()
+          : slot_(acquire_epoch()),
+            enclosing_(current_epoch())
+        {
+          current_epoch() = slot_;
+        }
+
+        inline ~epoch()
+        {
+          current_epoch() = enclosing_;
+          release_epoch(slot_);
+        }
+
+        epoch(const epoch&) = delete;
+        epoch& operator=(const epoch&) = delete;
+
+        // blocks until every message sent so far in this epoch has been executed by its destination
+        // each destination is asked how many of the epoch's messages it has executed,
+        // so waiting costs a round trip per destination rather than an acknowledgement per message
+        void wait() const;
+
+      private:
+        std::uint16_t slot_;
+        std::uint16_t enclosing_;
+    };
+
+    // calls try_continue on the polling thread after each poll until it returns true
+    // this lets work wait on a future without blocking a thread, so try_continue must not block
+    // like deadlines, continuations are only checked as often as the polling thread wakes
+    inline void add_continuation(std::function<bool()> try_continue)
+    {
+      std::lock_guard<std::mutex> lock(continuation_mutex_);
+      continuations_.emplace_back(std::move(try_continue));
+      ++num_continuations_;
+    }
+
+    // returns the number of one-sided messages sent to node which it has not yet acknowledged
+    inline std::size_t in_flight(std::size_t node) const
+    {
+      return credits().in_flight(node);
+    }
+
+    // returns the number of one-sided messages sent by this node which have not yet been acknowledged
+    inline std::size_t in_flight() const
+    {
+      return credits().total_in_flight();
+    }
+
+    // returns the number of requests sent to node which it hasn't finished:
+    // one-sided messages it hasn't acknowledged and two-sided requests it hasn't answered
+    // requests to this node are executed locally, so only its queued one-sided messages count
+    inline std::size_t outstanding(std::size_t node) const
+    {
+      if(is_this_node(node))
+      {
+        return num_local_messages_pending().load(std::memory_order_relaxed);
+      }
+
+      return in_flight(node) + replies_outstanding()[node].load(std::memory_order_relaxed);
+    }
+
+    // returns the number of one-sided messages waiting locally for a credit
+    inline std::size_t spilled() const
+    {
+      return num_spilled_.load();
+    }
+
+    // returns the number of one-sided messages to node waiting locally for a credit
+    inline std::size_t spilled(std::size_t node)
+    {
+      if(num_spilled_.load() == 0) return 0;
+
+      std::lock_guard<std::mutex> lock(spill_mutex_);
+      return spilled_[node].size();
+    }
+
+    inline flow_control_policy get_flow_control_policy() const
+    {
+      return flow_control_policy_.load();
+    }
+
+    inline void set_flow_control_policy(flow_control_policy policy)
+    {
+      flow_control_policy_.store(policy);
+    }
+
+    // returns the statistics collected by this node
+    inline execution_statistics statistics() const
+    {
+      return collect_statistics();
+    }
+
+    // returns the statistics collected by the given node
+    inline std::future<execution_statistics> statistics(std::size_t node)
+    {
+      return two_sided_execute(message_priority::high, node, &collect_statistics);
+    }
+
+    // returns the sum of the statistics collected by all nodes
+    inline execution_statistics aggregate_statistics()
+    {
+      std::vector<std::future<execution_statistics>> futures;
+      for(std::size_t node = 0; node < node_count(); ++node)
+      {
+        futures.emplace_back(statistics(node));
+      }
+
+      execution_statistics result;
+      for(std::future<execution_statistics>& future : futures)
+      {
+        result += future.get();
+      }
+
+      return result;
+    }
+
+    // writes the trace events recorded by this node to the file <prefix>.<node>.trace
+    // trace_to_json converts these files to the Chrome trace format
+    inline void dump_trace(const std::string& prefix) const
+    {
+      int node = shmem_my_pe();
+      tracer::dump(prefix + "." + std::to_string(node) + ".trace", node);
+    }
+
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<Function,Args...>::value),
+             __REQUIRES(can_deserialize_all<Function,Args...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    submission_status one_sided_execute(std::size_t node, Function&& f, Args&&... args)
+    {
+      return one_sided_execute(message_priority::normal, node, std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<Function,Args...>::value),
+             __REQUIRES(can_deserialize_all<Function,Args...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    submission_status one_sided_execute(message_priority priority, std::size_t node, Function&& f, Args&&... args)
+    {
+      return one_sided_execute(get_flow_control_policy(), priority, node, std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    // applies policy to this message rather than the context's flow_control_policy
+    // a message which mustn't be dropped, and which its sender can't retry, is sent with flow_control_policy::block,
+    // which spills the message rather than block when called from a handler
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<Function,Args...>::value),
+             __REQUIRES(can_deserialize_all<Function,Args...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    submission_status one_sided_execute(flow_control_policy policy, message_priority priority, std::size_t node, Function&& f, Args&&... args)
+    {
+      message_header header{make_message_id(), priority, handler_table::closure_handler_id, current_epoch(), compression_codec::none};
+      tracer::record(trace_event_kind::enqueue, header.id);
+
+      // messages to this node needn't be serialized or sent
+      if(is_this_node(node))
+      {
+        execute_locally(priority, header, decay_copy(std::forward<Function>(f)), decay_copy(std::forward<Args>(args))...);
+        return submission_status::sent;
+      }
+
+      // serialize the message straight from f and args, without copying them into an active_message
+      message_buffer serialized_message = serialize_message(header, active_message::view(std::forward<Function>(f), std::forward<Args>(args)...));
+
+      // transmit the serialization, subject to the destination's credit window
+      return submit(policy, node, header, std::move(serialized_message));
+    }
+
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<Function,Args...>::value),
+             __REQUIRES(can_deserialize_all<Function,Args...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    std::future<invoke_result_t<Function,typename std::decay<Args>::type...>>
+      two_sided_execute(std::size_t node, Function&& f, Args&&... args)
+    {
+      return two_sided_execute(message_priority::normal, node, std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<Function,Args...>::value),
+             __REQUIRES(can_deserialize_all<Function,Args...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    std::future<invoke_result_t<Function,typename std::decay<Args>::type...>>
+      two_sided_execute(message_priority priority, std::size_t node, Function&& f, Args&&... args)
+    {
+      return make_two_sided_request(priority, node, nullptr, nullptr, std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    // if no reply arrives by deadline, the returned future receives a timeout_error
+    // and its promise is reclaimed; a reply which arrives later is discarded
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<Function,Args...>::value),
+             __REQUIRES(can_deserialize_all<Function,Args...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    std::future<invoke_result_t<Function,typename std::decay<Args>::type...>>
+      two_sided_execute_until(std::size_t node, const std::chrono::steady_clock::time_point& deadline, Function&& f, Args&&... args)
+    {
+      return make_two_sided_request(message_priority::normal, node, &deadline, nullptr, std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    template<class Rep, class Period, class Function, class... Args,
+             __REQUIRES(can_serialize_all<Function,Args...>::value),
+             __REQUIRES(can_deserialize_all<Function,Args...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    std::future<invoke_result_t<Function,typename std::decay<Args>::type...>>
+      two_sided_execute_for(std::size_t node, const std::chrono::duration<Rep,Period>& timeout, Function&& f, Args&&... args)
+    {
+      std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+      return make_two_sided_request(message_priority::normal, node, &deadline, nullptr, std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    // if token is cancelled before a reply arrives, the returned future receives a cancellation_error
+    // and its promise is reclaimed; a reply which arrives later is discarded
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<Function,Args...>::value),
+             __REQUIRES(can_deserialize_all<Function,Args...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    std::future<invoke_result_t<Function,typename std::decay<Args>::type...>>
+      two_sided_execute(std::size_t node, const cancellation_token& token, Function&& f, Args&&... args)
+    {
+      return make_two_sided_request(message_priority::normal, node, nullptr, &token, std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<Function,Args...>::value),
+             __REQUIRES(can_deserialize_all<Function,Args...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    std::future<invoke_result_t<Function,typename std::decay<Args>::type...>>
+      two_sided_execute_until(std::size_t node, const std::chrono::steady_clock::time_point& deadline, const cancellation_token& token, Function&& f, Args&&... args)
+    {
+      return make_two_sided_request(message_priority::normal, node, &deadline, &token, std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    // registers f under id as the handler of messages whose arguments are those of Signature
+    // messages sent through the returned registered_handler skip the serializable_closure envelope:
+    // they carry only the handler's id and their arguments, which the receiver passes straight to f
+    // every node must register the same handlers under the same ids before messages are sent to them
+    template<class Signature, class Function,
+             __REQUIRES(is_registrable<typename std::decay<Function>::type,Signature>::value)
+            >
+    registered_handler<Signature> register_handler(std::size_t id, Function&& f)
+    {
+      return make_registered_handler<Signature>(id, std::forward<Function>(f));
+    }
+
+    // registers f under the lowest free id
+    // nodes which register the same handlers in the same order agree on their ids
+    template<class Signature, class Function,
+             __REQUIRES(is_registrable<typename std::decay<Function>::type,Signature>::value)
+            >
+    registered_handler<Signature> register_handler(Function&& f)
+    {
+      return make_registered_handler<Signature>(handler_table::capacity, std::forward<Function>(f));
+    }
+
+    template<class Result, class... Args,
+             __REQUIRES(is_registrable<Result(*)(Args...),Result(Args...)>::value)
+            >
+    registered_handler<Result(Args...)> register_handler(std::size_t id, Result (*f)(Args...))
+    {
+      return make_registered_handler<Result(Args...)>(id, f);
+    }
+
+    template<class Result, class... Args,
+             __REQUIRES(is_registrable<Result(*)(Args...),Result(Args...)>::value)
+            >
+    registered_handler<Result(Args...)> register_handler(Result (*f)(Args...))
+    {
+      return make_registered_handler<Result(Args...)>(handler_table::capacity, f);
+    }
+
+    template<class Result, class... Params, class... Args,
+             __REQUIRES(can_send<registered_handler<Result(Params...)>,Args...>::value)
+            >
+    submission_status one_sided_execute(std::size_t node, const registered_handler<Result(Params...)>& handler, Args&&... args)
+    {
+      return one_sided_execute(message_priority::normal, node, handler, std::forward<Args>(args)...);
+    }
+
+    template<class Result, class... Params, class... Args,
+             __REQUIRES(can_send<registered_handler<Result(Params...)>,Args...>::value)
+            >
+    submission_status one_sided_execute(message_priority priority, std::size_t node, const registered_handler<Result(Params...)>& handler, Args&&... args)
+    {
+      message_header header{make_message_id(), priority, static_cast<std::uint16_t>(handler.id()), current_epoch(), compression_codec::none};
+      tracer::record(trace_event_kind::enqueue, header.id);
+
+      if(is_this_node(node))
+      {
+        execute_locally(priority, header, local_handler_call(handler), static_cast<typename std::decay<Params>::type>(std::forward<Args>(args))...);
+        return submission_status::sent;
+      }
+
+      // arguments whose types differ from the handler's parameters are converted before they're serialized
+      message_buffer serialized_message = serialize_typed_message<Result(Params...)>(header, static_cast<const typename std::decay<Params>::type&>(args)...);
+
+      return submit(get_flow_control_policy(), node, header, std::move(serialized_message));
+    }
+
+    template<class Result, class... Params, class... Args,
+             __REQUIRES(can_send<registered_handler<Result(Params...)>,Args...>::value),
+             __REQUIRES(!std::is_void<Result>::value)
+            >
+    std::future<Result> two_sided_execute(std::size_t node, const registered_handler<Result(Params...)>& handler, Args&&... args)
+    {
+      return two_sided_execute(message_priority::normal, node, handler, std::forward<Args>(args)...);
+    }
+
+    template<class Result, class... Params, class... Args,
+             __REQUIRES(can_send<registered_handler<Result(Params...)>,Args...>::value),
+             __REQUIRES(!std::is_void<Result>::value)
+            >
+    std::future<Result> two_sided_execute(message_priority priority, std::size_t node, const registered_handler<Result(Params...)>& handler, Args&&... args)
+    {
+      message_header header{make_message_id(), priority, static_cast<std::uint16_t>(handler.id()), current_epoch(), compression_codec::none};
+      tracer::record(trace_event_kind::enqueue, header.id);
+
+      if(is_this_node(node))
+      {
+        return invoke_locally<Result>(header, local_handler_call(handler), static_cast<typename std::decay<Params>::type>(std::forward<Args>(args))...);
+      }
+
+      std::pair<int, std::future<Result>> id_and_future = unfulfilled_promises<Result>().add();
+
+      // the id of the promise precedes the arguments
+      message_buffer serialized_message = serialize_typed_message<Result(Params...)>(header, id_and_future.first, static_cast<const typename std::decay<Params>::type&>(args)...);
+
+      ++replies_outstanding()[node];
+      count_epoch_send(node, header);
+      send_request(node, two_sided_request_handler_id_, header, serialized_message);
+
+      return std::move(id_and_future.second);
+    }
+
+    // executes count calls, which are closure serializations written back to back and which each return a T,
+    // with a single request whose single reply fulfills all of the returned futures
+    // twoway_batch<T> builds these calls
+    template<class T>
+    std::vector<std::future<T>> two_sided_execute_batch(message_priority priority, std::size_t node, const std::string& calls, std::size_t count)
+    {
+      if(count == 0)
+      {
+        return std::vector<std::future<T>>();
+      }
+
+      message_header header{make_message_id(), priority, handler_table::closure_handler_id, current_epoch(), compression_codec::none};
+      tracer::record(trace_event_kind::enqueue, header.id);
+
+      // batches to this node are executed immediately by the calling thread
+      if(is_this_node(node))
+      {
+        return invoke_batch_locally<T>(header, calls);
+      }
+
+      // a single promise entry holds the promises of the whole batch
+      std::pair<int, std::vector<std::future<T>>> id_and_futures = unfulfilled_batches<T>().add(count);
+      int id = id_and_futures.first;
+
+      message_buffer serialized_message = serialize_message(header,
+        two_sided_active_message::view(&execute_batch<T>, std::forward_as_tuple(calls), &fulfill_batch<T>, std::make_tuple(id), &fail_batch<T>)
+      );
+
+      ++replies_outstanding()[node];
+      count_epoch_send(node, header);
+      send_request(node, two_sided_request_handler_id_, header, serialized_message);
+
+      return std::move(id_and_futures.second);
+    }
+
+  private:
+    // deadline and token are optional
+    template<class Function, class... Args>
+    std::future<invoke_result_t<Function,typename std::decay<Args>::type...>>
+      make_two_sided_request(message_priority priority, std::size_t node,
+                             const std::chrono::steady_clock::time_point* deadline, const cancellation_token* token,
+                             Function&& f, Args&&... args)
+    {
+      using result_type = invoke_result_t<Function,typename std::decay<Args>::type...>;
+
+      // don't bother sending a request which has already been cancelled
+      if(token && token->is_cancelled())
+      {
+        std::promise<result_type> cancelled;
+        cancelled.set_exception(std::make_exception_ptr(cancellation_error("two_sided_execute(): Request was cancelled.")));
+        return cancelled.get_future();
+      }
+
+      message_header header{make_message_id(), priority, handler_table::closure_handler_id, current_epoch(), compression_codec::none};
+      tracer::record(trace_event_kind::enqueue, header.id);
+
+      // requests to this node are executed immediately by the calling thread
+      // the result is ready before it could expire or be cancelled
+      if(is_this_node(node))
+      {
+        return invoke_locally<result_type>(header, decay_copy(std::forward<Function>(f)), decay_copy(std::forward<Args>(args))...);
+      }
+
+      // create a new unfulfilled promise
+      std::pair<int, std::future<result_type>> id_and_future = unfulfilled_promises<result_type>().add();
+      int id = id_and_future.first;
+
+      // serialize the message straight from f and args, without copying them into a two_sided_active_message
+      message_buffer serialized_message = serialize_message(header,
+        two_sided_active_message::view(std::forward<Function>(f), std::forward_as_tuple(std::forward<Args>(args)...), &fulfill_promise<result_type>, std::make_tuple(id), &fail_promise<result_type>)
+      );
+
+      // the deadline's timer is attached to the promise before the request is sent,
+      // so that whichever of the reply and the deadline comes first also removes the other
+      if(deadline)
+      {
+        unfulfilled_promises<result_type>().attach_timer(id, timers().schedule(*deadline, [id]
+        {
+          expire_promise<result_type>(id);
+        }));
+      }
+
+      // transmit the serialization
+      ++replies_outstanding()[node];
+      count_epoch_send(node, header);
+      send_request(node, two_sided_request_handler_id_, header, serialized_message);
+
+      if(token)
+      {
+        unfulfilled_promises<result_type>().attach(id, token->on_cancel([id]
+        {
+          cancel_promise<result_type>(id);
+        }));
+      }
+
+      // return the future
+      return std::move(id_and_future.second);
+    }
+
+    const static int one_sided_request_handler_id_ = 0;
+    const static int two_sided_request_handler_id_ = 1;
+    const static int two_sided_reply_handler_id_   = 2;
+    const static int rendezvous_handler_id_        = 3;
+    const static int credit_handler_id_            = 4;
+
+    // every message begins with a message_header, which precedes the message's serialization
+    struct message_header
+    {
+      // identifies a message and its reply in traces
+      std::uint64_t id;
+
+      // a reply shares its request's header, but replies are always executed immediately
+      message_priority priority;
+
+      // the registered handler which activates the message, or handler_table::closure_handler_id
+      std::uint16_t handler;
+
+      // the sending thread's epoch when the message was sent, or 0 outside of any epoch
+      std::uint16_t epoch;
+
+      // the codec which compressed the message's body, if any
+      compression_codec compression;
+
+      // the header is written as raw bytes so that handlers can read it in place
+      template<class OutputArchive>
+      friend void serialize(OutputArchive& ar, const message_header& self)
+      {
+        ar.stream().write(reinterpret_cast<const char*>(&self), sizeof(self));
+      }
+    };
+
+    inline static std::uint64_t make_message_id()
+    {
+      static std::atomic<std::uint64_t> counter{0};
+
+      // the high bits of the id identify the sending node
+      return (static_cast<std::uint64_t>(shmem_my_pe()) << 40) | counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline static bool is_this_node(std::size_t node)
+    {
+      return node == static_cast<std::size_t>(shmem_my_pe());
+    }
+
+    // a one-sided message to this node, which is kept in its original form rather than serialized
+    template<class Function, class... Args>
+    struct local_message
+    {
+      message_header header;
+      Function f;
+      std::tuple<Args...> args;
+
+      inline void operator()()
+      {
+        tracer::record(trace_event_kind::handler_enter, header.id);
+        ::apply(f, args);
+        tracer::record(trace_event_kind::activate_done, header.id);
+
+        count_epoch_completion(shmem_my_pe(), header);
+        --num_local_messages_pending();
+      }
+    };
+
+    // the number of local one-sided messages which have not yet been executed
+    inline static std::atomic<std::size_t>& num_local_messages_pending()
+    {
+      static std::atomic<std::size_t> result{0};
+      return result;
+    }
+
+    // like remote messages, high-priority local messages are executed immediately,
+    // and normal-priority local messages wait in the normal lane
+    template<class Function, class... Args>
+    static void execute_locally(message_priority priority, const message_header& header, Function f, Args... args)
+    {
+      local_message<Function,Args...> message{header, std::move(f), std::make_tuple(std::move(args)...)};
+
+      // the message decrements this when it's executed, whatever its priority
+      ++num_local_messages_pending();
+      count_epoch_send(shmem_my_pe(), header);
+
+      if(priority == message_priority::high)
+      {
+        message();
+      }
+      else
+      {
+        normal_lane().push(std::move(message));
+      }
+    }
+
+    template<class Result, class Function, class... Args>
+    static std::future<Result> invoke_locally(const message_header& header, Function f, Args... args)
+    {
+      std::promise<Result> promise;
+
+      tracer::record(trace_event_kind::handler_enter, header.id);
+
+      try
+      {
+        promise.set_value(f(std::move(args)...));
+      }
+      catch(...)
+      {
+        promise.set_exception(std::current_exception());
+      }
+
+      tracer::record(trace_event_kind::activate_done, header.id);
+
+      return promise.get_future();
+    }
+
+    // each call of a local batch gets its own promise, so one call's exception doesn't spoil the others
+    template<class T>
+    static std::vector<std::future<T>> invoke_batch_locally(const message_header& header, const std::string& calls)
+    {
+      std::vector<std::future<T>> result;
+
+      tracer::record(trace_event_kind::handler_enter, header.id);
+
+      serializable_closure::for_each_serialization(calls.data(), calls.size(), [&](const char* data, std::size_t size)
+      {
+        std::promise<T> promise;
+
+        try
+        {
+          promise.set_value(any_cast<T>(serializable_closure::invoke_serialization(data, size)));
+        }
+        catch(...)
+        {
+          promise.set_exception(std::current_exception());
+        }
+
+        result.emplace_back(promise.get_future());
+      });
+
+      tracer::record(trace_event_kind::activate_done, header.id);
+
+      return result;
+    }
+
+    // messages small enough to serialize into a message_buffer's inline storage are sent without allocating
+    using message_buffer = small_buffer<ACTIVE_MESSAGE_INLINE_MESSAGE_CAPACITY>;
+
+    // a message serialized by a handler, such as a reply, which is sent before the handler returns
+    using handler_message_buffer = small_buffer<ACTIVE_MESSAGE_INLINE_MESSAGE_CAPACITY, arena_allocator<char>>;
+
+    template<class Message, class Buffer>
+    static void serialize_message(message_header header, const Message& message, Buffer& result)
+    {
+      // a reply shares its request's header, but not necessarily its compression
+      header.compression = compression_codec::none;
+
+      serialize_to_buffer(result, header, message);
+      compress_message(result);
+    }
+
+    template<class Message>
+    static message_buffer serialize_message(const message_header& header, const Message& message)
+    {
+      message_buffer result;
+      serialize_message(header, message, result);
+      return result;
+    }
+
+    // set ACTIVE_MESSAGE_HANDLER_ARENA_SIZE to change the size of the arena each thread keeps for the
+    // temporaries of the handlers it executes, such as fetched, decompressed, and reply messages
+    // temporaries which don't fit in it are allocated individually and freed when the handler returns
+    inline static arena& handler_arena()
+    {
+      static thread_local arena result(environment_variable_or("ACTIVE_MESSAGE_HANDLER_ARENA_SIZE", 64 << 10));
+      return result;
+    }
+
+    // set ACTIVE_MESSAGE_COMPRESSION_THRESHOLD to compress the bodies of messages at least that large
+    // the default, 0, disables compression
+    inline static std::size_t compression_threshold()
+    {
+      static const std::size_t result = environment_variable_or("ACTIVE_MESSAGE_COMPRESSION_THRESHOLD", 0);
+      return result;
+    }
+
+    // set ACTIVE_MESSAGE_COMPRESSION_CODEC to "lz" (the default) or "lz4" to choose how messages are compressed
+    // receivers decompress whatever codec a message's header names, so nodes may differ
+    inline static compression_codec compression()
+    {
+      static const compression_codec result = std::getenv("ACTIVE_MESSAGE_COMPRESSION_CODEC") ?
+        parse_compression_codec(std::getenv("ACTIVE_MESSAGE_COMPRESSION_CODEC")) :
+        compression_codec::lz;
+
+      return result;
+    }
+
+    // a compressed message is its header, the size of its uncompressed body, and its compressed body
+    // messages are sent uncompressed when compression wouldn't make them smaller
+    template<class Buffer>
+    static void compress_message(Buffer& serialized_message)
+    {
+      std::size_t body_size = serialized_message.size() - sizeof(message_header);
+
+      if(compression_threshold() == 0 || body_size < compression_threshold() || compression() == compression_codec::none)
+      {
+        return;
+      }
+
+      message_header header = read_message_header(serialized_message.data());
+      header.compression = compression();
+
+      std::uint64_t uncompressed_size = body_size;
+      const std::size_t prefix_size = sizeof(header) + sizeof(uncompressed_size);
+
+      typename Buffer::string_type compressed(prefix_size + max_compressed_size(header.compression, body_size), 0, serialized_message.get_allocator());
+      std::size_t compressed_size = compress(header.compression, serialized_message.data() + sizeof(header), body_size, &compressed[prefix_size]);
+
+      if(sizeof(uncompressed_size) + compressed_size >= body_size)
+      {
+        return;
+      }
+
+      std::memcpy(&compressed[0], &header, sizeof(header));
+      std::memcpy(&compressed[sizeof(header)], &uncompressed_size, sizeof(uncompressed_size));
+      compressed.resize(prefix_size + compressed_size);
+
+      serialized_message.assign(std::move(compressed));
+    }
+
+    inline static message_header read_message_header(const void* data_buffer)
+    {
+      message_header result;
+      std::memcpy(&result, data_buffer, sizeof(result));
+      return result;
+    }
+
+    // activates the message which follows a message's header, reading it where it is rather than deserializing a copy
+    // the message's handler chooses how: activation selects the handler's one_sided or two_sided activation,
+    // and the result of a two-sided request is its reply
+    inline static any activate_message(const void* data_buffer_, std::size_t buffer_size, handler_table::activation handler_table::entry::*activation)
+    {
+      message_header header = read_message_header(data_buffer_);
+      const handler_table::entry& handler = handlers()[header.handler];
+
+      // skip over the header
+      const char* data_buffer = reinterpret_cast<const char*>(data_buffer_) + sizeof(message_header);
+      buffer_size -= sizeof(message_header);
+
+      if(header.compression != compression_codec::none)
+      {
+        std::uint64_t uncompressed_size = 0;
+        std::memcpy(&uncompressed_size, data_buffer, sizeof(uncompressed_size));
+
+        // the body is only needed until the message is activated
+        arena_scope scope(handler_arena());
+        char* body = static_cast<char*>(handler_arena().allocate(uncompressed_size, 1));
+        decompress(header.compression, data_buffer + sizeof(uncompressed_size), buffer_size - sizeof(uncompressed_size), body, uncompressed_size);
+
+        return (handler.*activation)(handler.function.get(), body, uncompressed_size);
+      }
+
+      return (handler.*activation)(handler.function.get(), data_buffer, buffer_size);
+    }
+
+    inline static handler_table& handlers()
+    {
+      static handler_table result;
+      return result;
+    }
+
+    // the id handler_table::capacity registers f under the lowest free id
+    template<class Signature, class Function>
+    static registered_handler<Signature> make_registered_handler(std::size_t id, Function&& f)
+    {
+      using function_type = typename std::decay<Function>::type;
+      using activation_type = typed_activation<function_type, Signature>;
+
+      std::shared_ptr<function_type> function = std::make_shared<function_type>(std::forward<Function>(f));
+      handler_table::entry entry{&activation_type::one_sided, activation_type::two_sided(), function};
+
+      if(id == handler_table::capacity)
+      {
+        id = handlers().insert(std::move(entry));
+      }
+      else
+      {
+        handlers().insert(id, std::move(entry));
+      }
+
+      return registered_handler<Signature>(id, &activation_type::invoke, function.get());
+    }
+
+    // a registered handler's message body is its signature's fingerprint, then, for a two-sided request,
+    // the id of the promise awaiting its reply, and then its arguments
+    template<class Function, class Signature,
+             class Indices = make_index_sequence<std::tuple_size<typename registered_handler<Signature>::arguments_type>::value>
+            >
+    struct typed_activation;
+
+
+    template<class Function, class Result, class... Args, size_t... Indices>
+    struct typed_activation<Function, Result(Args...), index_sequence<Indices...>>
+    {
+      using fingerprint = typename registered_handler<Result(Args...)>::fingerprint;
+
+      static constexpr const char* fingerprint_mismatch =
+        "execution_context: Type fingerprint mismatch. Did every node register the same handlers under the same ids?";
+
+      static Result invoke(void* function, typename std::decay<Args>::type&... args)
+      {
+        // the arguments are used only once, so move them into the function's parameters
+        return static_cast<Result>((*static_cast<Function*>(function))(std::move(args)...));
+      }
+
+      static any one_sided(void* function, const char* body, std::size_t size)
+      {
+        string_view_stream is(body, size);
+        input_archive archive(is);
+        check_type_fingerprint(read_type_fingerprint(archive), fingerprint::value, fingerprint_mismatch);
+
+        std::tuple<typename std::decay<Args>::type...> arguments;
+        archive(std::get<Indices>(arguments)...);
+
+        invoke(function, std::get<Indices>(arguments)...);
+        return any();
+      }
+
+      static any two_sided_request(void* function, const char* body, std::size_t size)
+      {
+        string_view_stream is(body, size);
+        input_archive archive(is);
+
+        // the fingerprint and the promise's id have the same types whatever the signature,
+        // so a sender whose signature differs learns of the mismatch through its future
+        std::uint64_t sent_fingerprint = read_type_fingerprint(archive);
+        int which = 0;
+        archive(which);
+
+        // like the reply of any other two-sided request, the reply is an active_message which fulfills the sender's promise,
+        // or fails it if the handler throws
+        try
+        {
+          check_type_fingerprint(sent_fingerprint, fingerprint::value, fingerprint_mismatch);
+
+          std::tuple<typename std::decay<Args>::type...> arguments;
+          archive(std::get<Indices>(arguments)...);
+
+          return active_message(&fulfill_promise<Result>, invoke(function, std::get<Indices>(arguments)...), which);
+        }
+        catch(const std::exception& e)
+        {
+          return active_message(&fail_promise<Result>, std::string(e.what()), which);
+        }
+        catch(...)
+        {
+          return active_message(&fail_promise<Result>, std::string("unknown exception"), which);
+        }
+      }
+
+      // handlers which return void can't answer two-sided requests
+      template<class R = Result, __REQUIRES(!std::is_void<R>::value)>
+      static handler_table::activation two_sided()
+      {
+        return &two_sided_request;
+      }
+
+      template<class R = Result, __REQUIRES(std::is_void<R>::value)>
+      static handler_table::activation two_sided()
+      {
+        return &one_sided;
+      }
+    };
+
+    template<class Signature, class... Values>
+    static message_buffer serialize_typed_message(const message_header& header, const Values&... values)
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_TYPE_FINGERPRINTS
+      std::uint64_t fingerprint = registered_handler<Signature>::fingerprint::value;
+      return serialize_message(header, std::forward_as_tuple(fingerprint, values...));
+#else
+      return serialize_message(header, std::forward_as_tuple(values...));
+#endif
+    }
+
+    // calls a registered handler's function on this node, without a message
+    template<class Result, class... Args>
+    struct local_handler
+    {
+      Result (*invoke)(void*, Args&...);
+      void* function;
+
+      template<class... Ts>
+      Result operator()(Ts&&... args) const
+      {
+        return invoke(function, args...);
+      }
+    };
+
+    template<class Result, class... Params>
+    static local_handler<Result, typename std::decay<Params>::type...> local_handler_call(const registered_handler<Result(Params...)>& handler)
+    {
+      return local_handler<Result, typename std::decay<Params>::type...>{handler.invoke(), handler.function()};
+    }
+
+    // messages at least this large are staged in symmetric memory and fetched by their receiver
+    // rather than transmitted through shmemx_am_request or shmemx_am_reply
+    // set ACTIVE_MESSAGE_RENDEZVOUS_THRESHOLD to change it
+    inline static std::size_t rendezvous_threshold()
+    {
+      static const std::size_t result = environment_variable_or("ACTIVE_MESSAGE_RENDEZVOUS_THRESHOLD", 64 << 10);
+      return result;
+    }
+
+    // set ACTIVE_MESSAGE_RENDEZVOUS_POOL_SIZE to change the amount of symmetric memory used to stage messages
+    // it must be the same on every node; 0 disables staging
+    inline static staging_pool& rendezvous_pool()
+    {
+      static staging_pool result(environment_variable_or("ACTIVE_MESSAGE_RENDEZVOUS_POOL_SIZE", 64 << 20));
+      return result;
+    }
+
+    // a rendezvous message describes a staged message
+    struct rendezvous_descriptor
+    {
+      // the offset of the staged message in the sender's rendezvous_pool()
+      std::uint64_t offset;
+      std::uint64_t size;
+
+      // the id of the handler which will receive the staged message
+      std::int32_t handler_id;
+    };
+
+    // true on the polling thread and the progress threads, which execute handlers
+    inline static bool& on_handler_thread()
+    {
+      static thread_local bool result = false;
+      return result;
+    }
+
+    // returns the staging area for a message of the given size, or nullptr if it should be sent eagerly
+    template<class Buffer>
+    static char* stage(const Buffer& serialized_message)
+    {
+      char* result = nullptr;
+
+      if(serialized_message.size() >= rendezvous_threshold())
+      {
+        // messages which can never fit in the pool are sent eagerly
+        // handler threads mustn't wait for another node to release blocks, because that node may be waiting
+        // on this one in turn, so they send eagerly when the pool is full
+        result = on_handler_thread() ?
+          rendezvous_pool().try_allocate(serialized_message.size()) :
+          rendezvous_pool().allocate(serialized_message.size());
+        if(result)
+        {
+          std::memcpy(result, serialized_message.data(), serialized_message.size());
+        }
+      }
+
+      return result;
+    }
+
+    // set ACTIVE_MESSAGE_CREDIT_WINDOW to bound the number of unacknowledged one-sided messages to each node
+    // the default, 0, is unlimited
+    inline static credit_window& credits()
+    {
+      static credit_window result(shmem_n_pes(), environment_variable_or("ACTIVE_MESSAGE_CREDIT_WINDOW", 0));
+      return result;
+    }
+
+    // set ACTIVE_MESSAGE_FLOW_CONTROL_POLICY to block, would_block, or spill to choose what happens to
+    // one-sided messages which exceed their credit window; the default is block
+    inline static flow_control_policy initial_flow_control_policy()
+    {
+      const char* name = std::getenv("ACTIVE_MESSAGE_FLOW_CONTROL_POLICY");
+      return name ? parse_flow_control_policy(name) : flow_control_policy::block;
+    }
+
+    // acquires a credit for node unless messages to node are already waiting in its spill queue,
+    // which would otherwise be overtaken
+    inline bool try_acquire_credit(std::size_t node)
+    {
+      if(num_spilled_.load() > 0)
+      {
+        std::lock_guard<std::mutex> lock(spill_mutex_);
+        return spilled_[node].empty() && credits().try_acquire(node);
+      }
+
+      return credits().try_acquire(node);
+    }
+
+    inline submission_status submit(flow_control_policy policy, std::size_t node, const message_header& header, message_buffer&& serialized_message)
+    {
+      // handler threads mustn't wait for credits: the polling thread receives them, and a progress thread
+      // may be executing the very message its destination is waiting on, so handlers spill rather than block
+      if(policy == flow_control_policy::block && on_handler_thread())
+      {
+        policy = flow_control_policy::spill;
+      }
+
+      while(!try_acquire_credit(node))
+      {
+        switch(policy)
+        {
+          case flow_control_policy::would_block:
+          {
+            return submission_status::would_block;
+          }
+
+          case flow_control_policy::spill:
+          {
+            std::lock_guard<std::mutex> lock(spill_mutex_);
+            spilled_[node].emplace_back(std::move(serialized_message));
+            ++num_spilled_;
+            count_epoch_send(node, header);
+            return submission_status::spilled;
+          }
+
+          case flow_control_policy::block:
+          {
+            std::this_thread::yield();
+            break;
+          }
+        }
+      }
+
+      count_epoch_send(node, header);
+      send_request(node, one_sided_request_handler_id_, header, serialized_message);
+      return submission_status::sent;
+    }
+
+    // sends spilled messages for which credits have become available
+    inline void send_spilled()
+    {
+      if(num_spilled_.load() == 0) return;
+
+      std::lock_guard<std::mutex> lock(spill_mutex_);
+
+      for(std::size_t node = 0; node < spilled_.size(); ++node)
+      {
+        std::deque<message_buffer>& queue = spilled_[node];
+
+        while(!queue.empty() && credits().try_acquire(node))
+        {
+          send_request(node, one_sided_request_handler_id_, read_message_header(queue.front().data()), queue.front());
+          queue.pop_front();
+          --num_spilled_;
+        }
+      }
+    }
+
+    inline static std::size_t environment_variable_or(const char* name, std::size_t default_value)
+    {
+      const char* value = std::getenv(name);
+      return value ? std::strtoull(value, nullptr, 10) : default_value;
+    }
+
+    inline static execution_statistics collect_statistics()
+    {
+      return statistics_collector::snapshot();
+    }
+
+    inline void poll()
+    {
+      using clock = statistics_collector::clock;
+
+      clock::time_point start = clock::now();
+      std::uint64_t num_received = statistics_collector::messages_received_by_this_thread();
+
+      shmemx_am_poll();
+
+      // without progress threads, the polling thread executes normal-priority messages itself
+      std::size_t num_dispatched = progress_threads_.empty() ? dispatch_normal_lane() : 0;
+
+      send_returned_credits();
+      send_spilled();
+      timers().advance();
+      std::size_t num_continued = run_continuations();
+
+      bool busy = num_dispatched > 0 || num_continued > 0 || num_received != statistics_collector::messages_received_by_this_thread();
+      clock::time_point polled = clock::now();
+
+      // keep polling while there's work to do
+      bool normal_lane_waiting = progress_threads_.empty() && !normal_lane().empty();
+      if(!busy && !normal_lane_waiting)
+      {
+        std::this_thread::sleep_for(poll_interval());
+      }
+
+      // a poll is only busy while it dispatches messages; the sleep after it is always idle
+      statistics_collector::record_poll(busy, polled - start);
+      statistics_collector::record_poll(false, clock::now() - polled);
+    }
+
+    // returns the number of continuations which finished
+    inline std::size_t run_continuations()
+    {
+      if(num_continuations_.load() == 0) return 0;
+
+      // continuations may add continuations, so don't hold the lock while calling them
+      std::vector<std::function<bool()>> pending;
+      {
+        std::lock_guard<std::mutex> lock(continuation_mutex_);
+        pending.swap(continuations_);
+      }
+
+      std::size_t result = 0;
+      std::vector<std::function<bool()>> unfinished;
+
+      for(std::function<bool()>& try_continue : pending)
+      {
+        if(try_continue())
+        {
+          ++result;
+        }
+        else
+        {
+          unfinished.emplace_back(std::move(try_continue));
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(continuation_mutex_);
+        continuations_.insert(continuations_.end(), std::make_move_iterator(unfinished.begin()), std::make_move_iterator(unfinished.end()));
+      }
+
+      num_continuations_ -= result;
+      return result;
+    }
+
+    // set ACTIVE_MESSAGE_TIMER_TICK_MICROSECONDS to change the resolution of deadlines
+    // deadlines are also only checked as often as the polling thread wakes
+    inline static timer_wheel& timers()
+    {
+      static timer_wheel result(std::chrono::microseconds(environment_variable_or("ACTIVE_MESSAGE_TIMER_TICK_MICROSECONDS", 10000)), 512);
+      return result;
+    }
+
+    // set ACTIVE_MESSAGE_PROGRESS_THREADS to execute normal-priority messages on that many threads
+    // in addition to the polling thread; the default, 0, executes them on the polling thread
+    // XXX openshmem-am doesn't say whether shmemx_am_poll may be called concurrently,
+    //     so only the polling thread polls, and high-priority messages execute serially
+    inline static std::size_t num_progress_threads()
+    {
+      static const std::size_t result = environment_variable_or("ACTIVE_MESSAGE_PROGRESS_THREADS", 0);
+      return result;
+    }
+
+    // returns the cpus on which each of num_threads threads may run: first the polling thread, then the progress threads
+    // set ACTIVE_MESSAGE_PROGRESS_CPUS to a cpu list (e.g., "2,3,6-7") to pin the polling thread to its first cpu
+    // and each progress thread to the next, wrapping around, or to "none" to leave the threads unpinned
+    // by default, the threads may run on any cpu of the NUMA node of the thread constructing the execution_context,
+    // so they never migrate across sockets
+    inline static std::vector<std::vector<int>> progress_cpus(std::size_t num_threads)
+    {
+      std::vector<std::vector<int>> result(num_threads);
+
+      const char* configured = std::getenv("ACTIVE_MESSAGE_PROGRESS_CPUS");
+
+      if(!configured)
+      {
+        std::fill(result.begin(), result.end(), numa_node_cpus_of_this_thread());
+      }
+      else if(std::string(configured) != "none")
+      {
+        std::vector<int> cpus = parse_cpu_list(configured);
+
+        for(std::size_t i = 0; i < num_threads && !cpus.empty(); ++i)
+        {
+          result[i].push_back(cpus[i % cpus.size()]);
+        }
+      }
+
+      return result;
+    }
+
+    // set ACTIVE_MESSAGE_POLL_INTERVAL_MICROSECONDS to change how long the polling thread sleeps
+    // after a poll which found nothing to do
+    inline static std::chrono::microseconds poll_interval()
+    {
+      static const std::chrono::microseconds result(environment_variable_or("ACTIVE_MESSAGE_POLL_INTERVAL_MICROSECONDS", 30000));
+      return result;
+    }
+
+    // queued normal-priority messages
+    inline static dispatch_queue& normal_lane()
+    {
+      static dispatch_queue result;
+      return result;
+    }
+
+    // set ACTIVE_MESSAGE_NORMAL_LANE_BATCH to change the number of normal-priority messages the polling thread
+    // executes before it returns credits, sends spilled messages, and expires deadlines
+    inline static std::size_t normal_lane_batch()
+    {
+      static const std::size_t result = environment_variable_or("ACTIVE_MESSAGE_NORMAL_LANE_BATCH", 64);
+      return result;
+    }
+
+    // executes a batch of normal-priority messages, polling after each one so that
+    // high-priority messages which arrive in the meantime needn't wait for the rest of the batch
+    // returns the number of messages executed
+    inline static std::size_t dispatch_normal_lane()
+    {
+      std::size_t result = 0;
+
+      while(result < normal_lane_batch() && normal_lane().run_one())
+      {
+        ++result;
+        shmemx_am_poll();
+      }
+
+      return result;
+    }
+
+    // the credits of deferred one-sided messages, which can't be returned with shmemx_am_reply
+    // because their handlers have already returned, accumulate here until the polling thread
+    // returns them in a single message per node
+    // without a credit window, the credits of high-priority messages accumulate here too
+    inline static std::atomic<std::uint32_t>* returned_credits()
+    {
+      static std::unique_ptr<std::atomic<std::uint32_t>[]> result(new std::atomic<std::uint32_t>[shmem_n_pes()]());
+      return result.get();
+    }
+
+    // the number of two-sided requests sent to each node which it hasn't yet answered
+    // a reply counts even when its promise has already expired or been cancelled, because the node still did the work
+    inline static std::atomic<std::size_t>* replies_outstanding()
+    {
+      static std::unique_ptr<std::atomic<std::size_t>[]> result(new std::atomic<std::size_t>[shmem_n_pes()]());
+      return result.get();
+    }
+
+    // the calling thread's innermost epoch, or 0 outside of any epoch
+    inline static std::uint16_t& current_epoch()
     {
-      // start shmem
-      shmem_init();
+      static thread_local std::uint16_t result = 0;
+      return result;
+    }
 
-      // register handlers
-      shmemx_am_attach(one_sided_request_handler_id_, one_sided_request_handler);
-      shmemx_am_attach(two_sided_request_handler_id_, two_sided_request_handler);
-      shmemx_am_attach(two_sided_reply_handler_id_,   two_sided_reply_handler);
+    // the epoch tables have a slot for each of the ACTIVE_MESSAGE_EPOCH_CAPACITY epochs, plus slot 0 for the messages sent outside of any epoch
+    static constexpr std::size_t num_epoch_slots = ACTIVE_MESSAGE_EPOCH_CAPACITY + 1;
 
-      // begin polling
-      polling_thread_ = std::thread([this]
+    static_assert(num_epoch_slots <= 1 << 16, "execution_context: Epochs must fit in a message_header's 16-bit epoch field.");
+
+    // epoch 0 is never acquired, so it tags the messages sent outside of any epoch
+    inline static std::uint16_t acquire_epoch()
+    {
+      std::lock_guard<std::mutex> lock(epoch_mutex());
+
+      std::vector<bool>& in_use = epochs_in_use();
+      for(std::size_t slot = 1; slot < in_use.size(); ++slot)
       {
-        while(continue_polling_)
+        if(!in_use[slot])
         {
-          shmemx_am_poll();
-          std::this_thread::sleep_for(std::chrono::milliseconds(30));
+          in_use[slot] = true;
+          return static_cast<std::uint16_t>(slot);
         }
-      });
+      }
+
+      throw std::runtime_error("execution_context::epoch: Too many epochs. Define ACTIVE_MESSAGE_EPOCH_CAPACITY to allow more.");
     }
 
-    inline ~execution_context()
+    inline static void release_epoch(std::uint16_t slot)
     {
-      continue_polling_ = false;
+      std::lock_guard<std::mutex> lock(epoch_mutex());
+      epochs_in_use()[slot] = false;
+    }
 
-      polling_thread_.join();
+    inline static std::mutex& epoch_mutex()
+    {
+      static std::mutex result;
+      return result;
+    }
 
-      // XXX note that we don't call shmem_finalize() because it may already have been shutdown
+    inline static std::vector<bool>& epochs_in_use()
+    {
+      static std::vector<bool> result(num_epoch_slots, false);
+      return result;
     }
 
-    inline std::size_t node_count() const
+    // the number of messages this node has sent to each node in each epoch, indexed by node * capacity + epoch
+    // the counts are never reset, so a reused epoch also waits for any stragglers of its previous owner
+    inline static std::atomic<std::uint64_t>* epochs_sent()
     {
-      return shmem_n_pes();
+      static std::unique_ptr<std::atomic<std::uint64_t>[]> result(new std::atomic<std::uint64_t>[shmem_n_pes() * num_epoch_slots]());
+      return result.get();
     }
-    
-    inline void wait_for_all()
+
+    // the number of messages this node has executed from each node in each epoch, indexed by sender * capacity + epoch
+    inline static std::atomic<std::uint64_t>* epochs_completed()
     {
-      shmemx_am_quiet();
+      static std::unique_ptr<std::atomic<std::uint64_t>[]> result(new std::atomic<std::uint64_t>[shmem_n_pes() * num_epoch_slots]());
+      return result.get();
     }
 
-    template<class Function, class... Args,
-             __REQUIRES(can_serialize_all<Function,Args...>::value),
-             __REQUIRES(can_deserialize_all<Function,Args...>::value),
-             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
-            >
-    void one_sided_execute(std::size_t node, Function&& f, Args&&... args)
+    inline static void count_epoch_send(std::size_t node, const message_header& header)
     {
-      // create a message
-      active_message message(decay_copy(std::forward<Function>(f)), decay_copy(std::forward<Args>(args))...);
+      if(header.epoch != 0)
+      {
+        epochs_sent()[node * num_epoch_slots + header.epoch].fetch_add(1, std::memory_order_relaxed);
+      }
+    }
 
-      // serialize the message
-      std::string serialized_message = to_string(message);
+    inline static void count_epoch_completion(std::size_t sender, const message_header& header)
+    {
+      if(header.epoch != 0)
+      {
+        epochs_completed()[sender * num_epoch_slots + header.epoch].fetch_add(1, std::memory_order_release);
+      }
+    }
 
-      // transmit the serialization
-      shmemx_am_request(node, one_sided_request_handler_id_, const_cast<char*>(serialized_message.data()), serialized_message.size());
+    // epoch::wait() asks each destination for this
+    inline static std::uint64_t epoch_completions(std::size_t sender, std::uint16_t epoch)
+    {
+      return epochs_completed()[sender * num_epoch_slots + epoch].load(std::memory_order_acquire);
     }
 
-    template<class Function, class... Args,
-             __REQUIRES(can_serialize_all<Function,Args...>::value),
-             __REQUIRES(can_deserialize_all<Function,Args...>::value),
-             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
-            >
-    std::future<invoke_result_t<Function,typename std::decay<Args>::type...>>
-      two_sided_execute(std::size_t node, Function&& f, Args&&... args)
+    // true when nothing this node has sent is waiting for a credit, to be executed, or to be answered
+    inline bool is_quiet() const
     {
-      using result_type = invoke_result_t<Function,typename std::decay<Args>::type...>;
+      if(num_spilled_.load() > 0 || num_local_messages_pending().load() > 0 || in_flight() > 0)
+      {
+        return false;
+      }
 
-      // create a new unfulfilled promise
-      std::pair<int, std::future<result_type>> id_and_future = unfulfilled_promises<result_type>().add();
+      for(std::size_t node = 0; node < node_count(); ++node)
+      {
+        if(replies_outstanding()[node].load(std::memory_order_relaxed) > 0)
+        {
+          return false;
+        }
+      }
 
-      // create a message
-      two_sided_active_message message(decay_copy(std::forward<Function>(f)), std::make_tuple(decay_copy(std::forward<Args>(args))...), &fulfill_promise<result_type>, std::make_tuple(id_and_future.first));
+      return true;
+    }
 
-      // serialize the message
-      std::string serialized_message = to_string(message);
+    inline static void send_returned_credits()
+    {
+      std::size_t node_count = shmem_n_pes();
 
-      // transmit the serialization
-      shmemx_am_request(node, two_sided_request_handler_id_, const_cast<char*>(serialized_message.data()), serialized_message.size());
+      for(std::size_t node = 0; node < node_count; ++node)
+      {
+        if(returned_credits()[node].load(std::memory_order_relaxed) > 0)
+        {
+          std::uint32_t num_credits = returned_credits()[node].exchange(0);
 
-      // return the future
-      return std::move(id_and_future.second);
+          statistics_collector::record_send(credit_handler_id_, sizeof(num_credits));
+          shmemx_am_request(node, credit_handler_id_, &num_credits, sizeof(num_credits));
+        }
+      }
     }
 
-  private:
-    const static int one_sided_request_handler_id_ = 0;
-    const static int two_sided_request_handler_id_ = 1;
-    const static int two_sided_reply_handler_id_   = 2;
+    // deferred replies are sent as requests, so the caller chooses how the send is traced
+    template<class Buffer>
+    static void send_request(std::size_t node, int handler_id, const message_header& header, const Buffer& serialized_message,
+                             trace_event_kind event = trace_event_kind::send)
+    {
+      statistics_collector::record_send(handler_id, serialized_message.size());
+      tracer::record(event, header.id);
+
+      if(char* staged = stage(serialized_message))
+      {
+        rendezvous_descriptor descriptor{rendezvous_pool().offset_of(staged), serialized_message.size(), handler_id};
+
+        statistics_collector::record_send(rendezvous_handler_id_, sizeof(descriptor));
+        shmemx_am_request(node, rendezvous_handler_id_, &descriptor, sizeof(descriptor));
+      }
+      else
+      {
+        shmemx_am_request(node, handler_id, const_cast<char*>(serialized_message.data()), serialized_message.size());
+      }
+    }
+
+    template<class Buffer>
+    static void send_reply(int handler_id, const message_header& header, const Buffer& serialized_message, shmemx_am_token_t token)
+    {
+      statistics_collector::record_send(handler_id, serialized_message.size());
+      tracer::record(trace_event_kind::reply_send, header.id);
+
+      if(char* staged = stage(serialized_message))
+      {
+        rendezvous_descriptor descriptor{rendezvous_pool().offset_of(staged), serialized_message.size(), handler_id};
+
+        statistics_collector::record_send(rendezvous_handler_id_, sizeof(descriptor));
+        shmemx_am_reply(rendezvous_handler_id_, &descriptor, sizeof(descriptor), token);
+      }
+      else
+      {
+        shmemx_am_reply(handler_id, const_cast<char*>(serialized_message.data()), serialized_message.size(), token);
+      }
+    }
+
+    // rendezvous_handler receives both requests and replies
+    // it fetches a staged message and passes it to the handler the message was meant for
+    inline static void rendezvous_handler(void* data_buffer, size_t buffer_size, int calling_pe, shmemx_am_token_t token)
+    {
+      statistics_collector::handler_scope scope(rendezvous_handler_id_, buffer_size);
+      arena_scope temporaries(handler_arena());
+
+      rendezvous_descriptor descriptor;
+      std::memcpy(&descriptor, data_buffer, sizeof(descriptor));
+
+      // XXX it's unclear whether the shmem implementation permits RMA inside an active message handler
+
+      // fetch the message and release its staging area
+      char* message = static_cast<char*>(handler_arena().allocate(descriptor.size));
+      shmem_getmem(message, rendezvous_pool().address_of(descriptor.offset), descriptor.size, calling_pe);
+      rendezvous_pool().release(descriptor.offset, calling_pe);
+
+      switch(descriptor.handler_id)
+      {
+        case one_sided_request_handler_id_:
+        {
+          one_sided_request_handler(message, descriptor.size, calling_pe, token);
+          break;
+        }
+
+        case two_sided_request_handler_id_:
+        {
+          two_sided_request_handler(message, descriptor.size, calling_pe, token);
+          break;
+        }
+
+        case two_sided_reply_handler_id_:
+        {
+          two_sided_reply_handler(message, descriptor.size, calling_pe, token);
+          break;
+        }
+      }
+    }
 
     inline static void one_sided_request_handler(void* data_buffer_, size_t buffer_size, int calling_pe, shmemx_am_token_t token)
     {
-      // deserialize the message
-      const char* data_buffer = reinterpret_cast<const char*>(const_cast<const void*>(data_buffer_));
-      active_message message = from_string<active_message>(data_buffer, buffer_size);
+      statistics_collector::handler_scope scope(one_sided_request_handler_id_, buffer_size);
+      arena_scope temporaries(handler_arena());
+
+      message_header header = read_message_header(data_buffer_);
+      tracer::record(trace_event_kind::handler_enter, header.id);
+
+      if(header.priority == message_priority::high)
+      {
+        execute_one_sided_request(data_buffer_, buffer_size, calling_pe);
+
+        // with a credit window, the sender may be waiting for this credit, so it's returned immediately
+        // otherwise it only counts toward the sender's outstanding(), so it's returned with the others at the next poll
+        if(credits().window() > 0)
+        {
+          std::uint32_t num_credits = 1;
+          statistics_collector::record_send(credit_handler_id_, sizeof(num_credits));
+          shmemx_am_reply(credit_handler_id_, &num_credits, sizeof(num_credits), token);
+        }
+        else
+        {
+          ++returned_credits()[calling_pe];
+        }
+      }
+      else
+      {
+        normal_lane().push(deferred_request{one_sided_request_handler_id_, calling_pe, std::string(reinterpret_cast<const char*>(data_buffer_), buffer_size)});
+      }
+    }
+
+    inline static void execute_one_sided_request(const void* data_buffer_, size_t buffer_size, int calling_pe)
+    {
+      message_header header = read_message_header(data_buffer_);
 
       // activate the message and discard the result
-      message.activate();
+      activate_message(data_buffer_, buffer_size, &handler_table::entry::one_sided);
+      tracer::record(trace_event_kind::activate_done, header.id);
+
+      count_epoch_completion(calling_pe, header);
+    }
+
+    inline static void credit_handler(void* data_buffer, size_t buffer_size, int calling_pe, shmemx_am_token_t token)
+    {
+      statistics_collector::handler_scope scope(credit_handler_id_, buffer_size);
+
+      std::uint32_t num_credits = 0;
+      std::memcpy(&num_credits, data_buffer, sizeof(num_credits));
+
+      credits().release(calling_pe, num_credits);
     }
 
     inline static void two_sided_request_handler(void* data_buffer_, size_t buffer_size, int calling_pe, shmemx_am_token_t token)
     {
-      // deserialize the message
-      const char* data_buffer = reinterpret_cast<const char*>(const_cast<const void*>(data_buffer_));
-      two_sided_active_message message = from_string<two_sided_active_message>(data_buffer, buffer_size);
+      statistics_collector::handler_scope scope(two_sided_request_handler_id_, buffer_size);
+      arena_scope temporaries(handler_arena());
 
-      // activate the message and get the reply
-      active_message reply = message.activate();
+      message_header header = read_message_header(data_buffer_);
+      tracer::record(trace_event_kind::handler_enter, header.id);
 
-      // serialize the reply
-      std::string serialized_reply = to_string(reply);
+      if(header.priority == message_priority::high)
+      {
+        handler_message_buffer serialized_reply = execute_two_sided_request(data_buffer_, buffer_size, calling_pe);
 
-      // transmit the serialization
-      shmemx_am_reply(two_sided_reply_handler_id_, const_cast<char*>(serialized_reply.data()), serialized_reply.size(), token);
+        // transmit the serialization
+        send_reply(two_sided_reply_handler_id_, header, serialized_reply, token);
+      }
+      else
+      {
+        normal_lane().push(deferred_request{two_sided_request_handler_id_, calling_pe, std::string(reinterpret_cast<const char*>(data_buffer_), buffer_size)});
+      }
     }
 
+    // returns the serialized reply, which is allocated from the handler arena
+    inline static handler_message_buffer execute_two_sided_request(const void* data_buffer_, size_t buffer_size, int calling_pe)
+    {
+      message_header header = read_message_header(data_buffer_);
+
+      // activate the message and get the reply, which needn't be deserialized only to be serialized again
+      any reply = activate_message(data_buffer_, buffer_size, &handler_table::entry::two_sided);
+      tracer::record(trace_event_kind::activate_done, header.id);
+
+      count_epoch_completion(calling_pe, header);
+
+      // serialize the reply, which shares the message's header
+      // the reply is an active_message even when the request was for a registered handler
+      header.handler = handler_table::closure_handler_id;
+      handler_message_buffer result{arena_allocator<char>(handler_arena())};
+      serialize_message(header, reply, result);
+      return result;
+    }
+
+    // a normal-priority request waiting in the normal lane
+    // because its handler has returned, it answers its sender with shmemx_am_request rather than shmemx_am_reply
+    struct deferred_request
+    {
+      int handler_id;
+      int calling_pe;
+      std::string message;
+
+      inline void operator()() const
+      {
+        arena_scope temporaries(handler_arena());
+
+        if(handler_id == one_sided_request_handler_id_)
+        {
+          execute_one_sided_request(message.data(), message.size(), calling_pe);
+          ++returned_credits()[calling_pe];
+        }
+        else
+        {
+          handler_message_buffer serialized_reply = execute_two_sided_request(message.data(), message.size(), calling_pe);
+          send_request(calling_pe, two_sided_reply_handler_id_, read_message_header(message.data()), serialized_reply, trace_event_kind::reply_send);
+        }
+      }
+    };
+
     inline static void two_sided_reply_handler(void *data_buffer_, size_t buffer_size, int calling_pe, shmemx_am_token_t token)
     {
-      // deserialize the reply
-      const char* data_buffer = reinterpret_cast<const char*>(const_cast<const void*>(data_buffer_));
-      active_message reply = from_string<active_message>(data_buffer, buffer_size);
+      statistics_collector::handler_scope scope(two_sided_reply_handler_id_, buffer_size);
+      arena_scope temporaries(handler_arena());
+
+      --replies_outstanding()[calling_pe];
+
+      message_header header = read_message_header(data_buffer_);
 
       // activate the reply
-      reply.activate();
+      activate_message(data_buffer_, buffer_size, &handler_table::entry::one_sided);
+      tracer::record(trace_event_kind::future_fulfilled, header.id);
     }
 
+    // the promises of a two-sided batch, which are fulfilled together by a single reply
     template<class T>
+    class promise_batch
+    {
+      public:
+        promise_batch() = default;
+
+        explicit promise_batch(std::size_t n)
+          : promises_(n)
+        {}
+
+        std::vector<std::future<T>> get_future()
+        {
+          std::vector<std::future<T>> result;
+          result.reserve(promises_.size());
+
+          for(std::promise<T>& promise : promises_)
+          {
+            result.emplace_back(promise.get_future());
+          }
+
+          return result;
+        }
+
+        // outcomes is the reply of execute_batch(): for each call, whether it succeeded,
+        // and then its result, or the what() of the exception it threw
+        void set_value(std::string&& outcomes)
+        {
+          string_view_stream is(outcomes.data(), outcomes.size());
+          input_archive archive(is);
+
+          for(std::promise<T>& promise : promises_)
+          {
+            bool succeeded = false;
+            archive(succeeded);
+
+            if(succeeded)
+            {
+              T value;
+              archive(value);
+              promise.set_value(std::move(value));
+            }
+            else
+            {
+              std::string what;
+              archive(what);
+              promise.set_exception(std::make_exception_ptr(remote_error(what)));
+            }
+          }
+        }
+
+        void set_exception(std::exception_ptr exception)
+        {
+          for(std::promise<T>& promise : promises_)
+          {
+            promise.set_exception(exception);
+          }
+        }
+
+      private:
+        std::vector<std::promise<T>> promises_;
+    };
+
+    // Promise is either std::promise<T> or promise_batch<T>
+    template<class T, class Promise = std::promise<T>>
     class promise_collection
     {
       public:
+        using future_type = decltype(std::declval<Promise&>().get_future());
+
         promise_collection()
           : counter_{}
         {}
     
-        std::pair<int, std::future<T>> add()
+        // args... are passed to the promise's constructor
+        template<class... Args>
+        std::pair<int, future_type> add(Args&&... args)
         {
           std::lock_guard<std::mutex> lock(mutex_);
 
           int id = make_id();
     
-          std::promise<T> promise;
+          Promise promise(std::forward<Args>(args)...);
     
-          std::future<T> future = promise.get_future();
+          future_type future = promise.get_future();
     
-          promises_.emplace(id, std::move(promise));
+          promises_[id].promise = std::move(promise);
+
+          statistics_collector::record_promise_added();
     
           return std::make_pair(id, std::move(future));
         }
+
+        // cancels the deadline's timer when the promise is fulfilled or abandoned,
+        // so that the timer wheel holds timers only for requests which are still outstanding
+        void attach_timer(int which, timer_wheel::handle timer)
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+
+          auto found = promises_.find(which);
+          if(found == promises_.end())
+          {
+            // the timer has already fired
+            timers().cancel(timer);
+            return;
+          }
+
+          found->second.timer = timer;
+        }
+
+        // ties the lifetime of a cancellation callback to the promise it cancels
+        void attach(int which, cancellation_registration registration)
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+
+          auto found = promises_.find(which);
+          if(found != promises_.end())
+          {
+            found->second.registration = std::move(registration);
+          }
+        }
     
         template<class U>
         void fulfill(int which, U&& result)
         {
           std::lock_guard<std::mutex> lock(mutex_);
 
+          auto found = promises_.find(which);
+          if(found == promises_.end())
+          {
+            // the promise timed out or was cancelled before its reply arrived
+            statistics_collector::record_late_reply();
+            return;
+          }
+
           // move the promise out of the collection
-          std::promise<T> promise = std::move(promises_[which]);
+          Promise promise = std::move(found->second.promise);
+          timer_wheel::handle timer = found->second.timer;
     
           // erase that position from the collection
-          promises_.erase(which);
+          promises_.erase(found);
+          cancel_timer(timer);
+
+          statistics_collector::record_promise_removed();
     
           // set the promise's value
           promise.set_value(std::forward<U>(result));
         }
+
+        // fails a promise which is still waiting for its reply
+        // returns false if the promise has already been removed
+        bool abandon(int which, std::exception_ptr exception)
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+
+          auto found = promises_.find(which);
+          if(found == promises_.end())
+          {
+            return false;
+          }
+
+          Promise promise = std::move(found->second.promise);
+          timer_wheel::handle timer = found->second.timer;
+
+          promises_.erase(found);
+          cancel_timer(timer);
+
+          statistics_collector::record_promise_removed();
+
+          promise.set_exception(exception);
+          return true;
+        }
     
       private:
         int make_id()
         {
           return counter_++;
         }
+
+        inline static void cancel_timer(timer_wheel::handle timer)
+        {
+          if(timer != timer_wheel::no_timer)
+          {
+            timers().cancel(timer);
+          }
+        }
+
+        struct entry
+        {
+          Promise promise;
+          cancellation_registration registration;
+          timer_wheel::handle timer = timer_wheel::no_timer;
+        };
     
         std::mutex mutex_;
         int counter_;
-        std::unordered_map<int, std::promise<T>> promises_;
+        std::unordered_map<int, entry> promises_;
     };
 
     template<class T>
@@ -227,6 +2000,79 @@ class execution_context
       unfulfilled_promises<T>().fulfill(which, std::move(result));
     }
 
+    template<class T>
+    static promise_collection<T, promise_batch<T>>& unfulfilled_batches()
+    {
+      static promise_collection<T, promise_batch<T>> result;
+      return result;
+    }
+
+    template<class T>
+    static void fulfill_batch(std::string outcomes, int which)
+    {
+      unfulfilled_batches<T>().fulfill(which, std::move(outcomes));
+    }
+
+    // executes the calls of a two-sided batch in order and returns their outcomes, which form its reply
+    // each call's outcome records its own exception, so, as in a local batch, one call's exception doesn't spoil the others
+    template<class T>
+    static std::string execute_batch(const std::string& calls)
+    {
+      std::string result;
+      string_output_stream os(result);
+      output_archive archive(os);
+
+      serializable_closure::for_each_serialization(calls.data(), calls.size(), [&](const char* data, std::size_t size)
+      {
+        try
+        {
+          T value = any_cast<T>(serializable_closure::invoke_serialization(data, size));
+          archive(true, value);
+        }
+        catch(const std::exception& e)
+        {
+          archive(false, std::string(e.what()));
+        }
+        catch(...)
+        {
+          archive(false, std::string("unknown exception"));
+        }
+      });
+
+      return result;
+    }
+
+    // the reply of a request which threw on the node which executed it
+    template<class T>
+    static void fail_promise(std::string what, int which)
+    {
+      unfulfilled_promises<T>().abandon(which, std::make_exception_ptr(remote_error(what)));
+    }
+
+    template<class T>
+    static void fail_batch(std::string what, int which)
+    {
+      unfulfilled_batches<T>().abandon(which, std::make_exception_ptr(remote_error(what)));
+    }
+
+    template<class T>
+    static void expire_promise(int which)
+    {
+      if(unfulfilled_promises<T>().abandon(which, std::make_exception_ptr(timeout_error("two_sided_execute(): Deadline passed before a reply arrived."))))
+      {
+        statistics_collector::record_promise_timed_out();
+      }
+    }
+
+    template<class T>
+    static void cancel_promise(int which)
+    {
+      if(unfulfilled_promises<T>().abandon(which, std::make_exception_ptr(cancellation_error("two_sided_execute(): Request was cancelled."))))
+      {
+        statistics_collector::record_promise_cancelled();
+      }
+    }
+
     template<class Arg>
     static typename std::decay<Arg>::type decay_copy(Arg&& arg)
     {
@@ -236,6 +2082,22 @@ class execution_context
     // this flag lets the polling thread to know when to stop polling
     std::atomic<bool> continue_polling_;
 
+    std::atomic<flow_control_policy> flow_control_policy_;
+
+    // one-sided messages which exceeded their destination's credit window under the spill policy
+    // the polling thread sends them as credits are returned
+    std::mutex spill_mutex_;
+    std::vector<std::deque<message_buffer>> spilled_;
+    std::atomic<std::size_t> num_spilled_;
+
+    // work waiting on futures, which the polling thread checks after each poll
+    std::mutex continuation_mutex_;
+    std::vector<std::function<bool()>> continuations_;
+    std::atomic<std::size_t> num_continuations_;
+
+    // these threads execute normal-priority messages
+    std::vector<std::thread> progress_threads_;
+
     // this thread calls shmemx_am_poll, which allows other threads on this node to make progress
     std::thread polling_thread_;
 };
@@ -250,3 +2112,56 @@ inline execution_context& system_context()
   return system_context_;
 }
 
+
+inline void execution_context::epoch::wait() const
+{
+  // the queries below belong to no epoch, so that they don't count among the messages they ask about
+  struct suspension
+  {
+    std::uint16_t suspended = current_epoch();
+
+    suspension() { current_epoch() = 0; }
+    ~suspension() { current_epoch() = suspended; }
+  } untagged;
+
+  std::size_t this_node = shmem_my_pe();
+
+  // the number of the epoch's messages sent to each node so far
+  std::vector<std::pair<std::size_t, std::uint64_t>> unfinished;
+  for(std::size_t node = 0; node < system_context().node_count(); ++node)
+  {
+    std::uint64_t sent = epochs_sent()[node * num_epoch_slots + slot_].load(std::memory_order_relaxed);
+
+    if(sent > 0)
+    {
+      unfinished.emplace_back(node, sent);
+    }
+  }
+
+  while(!unfinished.empty())
+  {
+    // ask every unfinished node at once rather than waiting on them one at a time
+    std::vector<std::future<std::uint64_t>> completions;
+    for(const std::pair<std::size_t, std::uint64_t>& node_and_sent : unfinished)
+    {
+      completions.emplace_back(system_context().two_sided_execute(message_priority::high, node_and_sent.first, &epoch_completions, this_node, slot_));
+    }
+
+    std::vector<std::pair<std::size_t, std::uint64_t>> still_unfinished;
+    for(std::size_t i = 0; i < unfinished.size(); ++i)
+    {
+      if(completions[i].get() < unfinished[i].second)
+      {
+        still_unfinished.push_back(unfinished[i]);
+      }
+    }
+
+    unfinished.swap(still_unfinished);
+
+    if(!unfinished.empty())
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
@@ -0,0 +1,136 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <stdexcept>
+
+
+// what one_sided_execute() does with a message which would exceed its destination's credit window
+enum class flow_control_policy
+{
+  block,       // wait until the destination returns a credit
+  would_block, // drop the message and return submission_status::would_block
+  spill        // queue the message locally; the polling thread sends it once a credit is returned
+};
+
+
+// the result of one_sided_execute()
+enum class submission_status
+{
+  sent,
+  would_block,
+  spilled
+};
+
+
+// parses the names of flow_control_policy's enumerators, as used by ACTIVE_MESSAGE_FLOW_CONTROL_POLICY
+inline flow_control_policy parse_flow_control_policy(const char* name)
+{
+  if(std::strcmp(name, "block") == 0)       return flow_control_policy::block;
+  if(std::strcmp(name, "would_block") == 0) return flow_control_policy::would_block;
+  if(std::strcmp(name, "spill") == 0)       return flow_control_policy::spill;
+
+  throw std::runtime_error(std::string("parse_flow_control_policy(): Unknown policy ") + name);
+}
+
+
+// credit_window bounds the number of messages in flight to each destination
+// a credit is acquired when a message is sent and returned when its receiver acknowledges it
+class credit_window
+{
+  public:
+    // a window of 0 is unlimited: messages are counted but never refused
+    inline credit_window(std::size_t node_count, std::size_t window)
+      : node_count_(node_count),
+        window_(window),
+        in_flight_(new std::atomic<std::size_t>[node_count])
+    {
+      for(std::size_t node = 0; node < node_count_; ++node)
+      {
+        in_flight_[node].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    inline std::size_t window() const
+    {
+      return window_;
+    }
+
+    // returns true if a credit for node was available and has been acquired
+    inline bool try_acquire(std::size_t node)
+    {
+      if(window_ == 0)
+      {
+        in_flight_[node].fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+
+      std::size_t expected = in_flight_[node].load(std::memory_order_relaxed);
+      while(expected < window_)
+      {
+        if(in_flight_[node].compare_exchange_weak(expected, expected + 1, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    inline void release(std::size_t node, std::size_t num_credits)
+    {
+      in_flight_[node].fetch_sub(num_credits, std::memory_order_release);
+    }
+
+    // returns the number of messages sent to node which have not yet been acknowledged
+    inline std::size_t in_flight(std::size_t node) const
+    {
+      return in_flight_[node].load(std::memory_order_acquire);
+    }
+
+    inline std::size_t total_in_flight() const
+    {
+      std::size_t result = 0;
+      for(std::size_t node = 0; node < node_count_; ++node)
+      {
+        result += in_flight(node);
+      }
+
+      return result;
+    }
+
+  private:
+    std::size_t node_count_;
+    std::size_t window_;
+    std::unique_ptr<std::atomic<std::size_t>[]> in_flight_;
+};
+
@@ -0,0 +1,75 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// $ ./openshmem-am-root/bin/oshc++ -std=c++11 global_ptr.cpp 
+// $ ./openshmem-am-root/bin/oshrun ./a.out -n 2
+// PE 0: PE 1's counter is 10
+// PE 1: Incrementing my counter by 3
+// PE 0: PE 1's counter is now 13
+
+#include <iostream>
+#include <future>
+#include <cassert>
+
+#include "global_ptr.hpp"
+
+
+int increment(int* counter, int amount)
+{
+  std::cout << "PE " << shmem_my_pe() << ": Incrementing my counter by " << amount << std::endl;
+
+  *counter += amount;
+  return *counter;
+}
+
+int main()
+{
+  // each node allocates its counter in the symmetric heap
+  int* counter = static_cast<int*>(shmem_malloc(sizeof(int)));
+  *counter = 0;
+
+  shmem_barrier_all();
+
+  if(shmem_my_pe() == 0)
+  {
+    global_ptr<int> remote_counter(1, counter);
+
+    // write and read PE 1's counter directly
+    // the put may still be in flight until quiet() returns
+    remote_counter.put(10);
+    remote_counter.quiet();
+    std::cout << "PE 0: PE 1's counter is " << remote_counter.get() << std::endl;
+
+    // ship the increment to PE 1 rather than reading, modifying and writing its counter from here
+    std::future<int> result = remote_counter.twoway_execute_at_owner(increment, 3);
+    int incremented = result.get();
+    assert(incremented == 13 && remote_counter.get() == 13);
+
+    std::cout << "PE 0: PE 1's counter is now " << incremented << std::endl;
+  }
+
+  shmem_barrier_all();
+}
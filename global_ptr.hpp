@@ -0,0 +1,226 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <shmem.h>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <type_traits>
+
+#include "serialization.hpp"
+#include "execution_context.hpp"
+
+
+// global_ptr<T> refers to an object of type T in the symmetric heap of a particular node
+// it is a (node, symmetric offset) pair: a symmetric object's address may differ from node to node,
+// but its offset from execution_context::symmetric_heap_base() doesn't, so the offset is meaningful
+// wherever the global_ptr travels and each node translates it into its own address
+template<class T>
+class global_ptr
+{
+  public:
+    using element_type = T;
+
+    inline global_ptr()
+      : global_ptr(nullptr)
+    {}
+
+    inline global_ptr(std::nullptr_t)
+      : node_(0),
+        offset_(null_offset)
+    {}
+
+    // symmetric_address is this node's address of a symmetric object (e.g., it was returned by shmem_malloc)
+    // the global_ptr refers to the corresponding object on node
+    inline global_ptr(std::size_t node, T* symmetric_address)
+      : node_(node),
+        offset_(symmetric_address ? reinterpret_cast<char*>(symmetric_address) - execution_context::symmetric_heap_base() : null_offset)
+    {}
+
+    inline std::size_t node() const
+    {
+      return node_;
+    }
+
+    // returns this node's address of the referenced object, which names it in shmem calls
+    // it may only be dereferenced directly when is_local() is true
+    inline T* get_address() const
+    {
+      return offset_ == null_offset ? nullptr : reinterpret_cast<T*>(execution_context::symmetric_heap_base() + offset_);
+    }
+
+    inline bool is_local() const
+    {
+      return node_ == static_cast<std::size_t>(shmem_my_pe());
+    }
+
+    // reads the referenced object with shmem_getmem
+    inline T get() const
+    {
+      static_assert(std::is_trivially_copyable<T>::value, "global_ptr<T>::get() requires a trivially copyable T.");
+
+      T result;
+      shmem_getmem(&result, get_address(), sizeof(T), node_);
+      return result;
+    }
+
+    // reads n objects beginning at the referenced object into destination
+    inline void get(T* destination, std::size_t n) const
+    {
+      static_assert(std::is_trivially_copyable<T>::value, "global_ptr<T>::get() requires a trivially copyable T.");
+
+      shmem_getmem(destination, get_address(), n * sizeof(T), node_);
+    }
+
+    // writes the referenced object with shmem_putmem
+    // the write may still be in flight when put() returns: call quiet() before anything which must observe it,
+    // such as a get() of the same object or a message which reads it on its owner
+    inline void put(const T& value) const
+    {
+      static_assert(std::is_trivially_copyable<T>::value, "global_ptr<T>::put() requires a trivially copyable T.");
+
+      shmem_putmem(get_address(), &value, sizeof(T), node_);
+    }
+
+    // writes n objects beginning at source to the referenced object and its successors
+    // like put(value), the writes may still be in flight when it returns
+    inline void put(const T* source, std::size_t n) const
+    {
+      static_assert(std::is_trivially_copyable<T>::value, "global_ptr<T>::put() requires a trivially copyable T.");
+
+      shmem_putmem(get_address(), source, n * sizeof(T), node_);
+    }
+
+    // waits until every put() this node has issued, through any global_ptr, has completed at its destination
+    inline static void quiet()
+    {
+      shmem_quiet();
+    }
+
+    // executes f(p, args...) on the owning node, where p is the owner's pointer to the referenced object
+    // this moves the computation to the data rather than the data to the computation
+    // f may run before an earlier put() lands unless quiet() is called in between
+    template<class Function, class... Args,
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,T*,typename std::decay<Args>::type...>::value)
+            >
+    submission_status execute_at_owner(Function&& f, Args&&... args) const
+    {
+      return system_context().one_sided_execute(node_, &invoke_at_owner<typename std::decay<Function>::type,typename std::decay<Args>::type...>,
+        std::forward<Function>(f), *this, std::forward<Args>(args)...
+      );
+    }
+
+    // executes f(p, args...) on the owning node and returns a future for its result
+    template<class Function, class... Args,
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,T*,typename std::decay<Args>::type...>::value)
+            >
+    std::future<invoke_result_t<Function,T*,typename std::decay<Args>::type...>>
+      twoway_execute_at_owner(Function&& f, Args&&... args) const
+    {
+      return system_context().two_sided_execute(node_, &invoke_at_owner<typename std::decay<Function>::type,typename std::decay<Args>::type...>,
+        std::forward<Function>(f), *this, std::forward<Args>(args)...
+      );
+    }
+
+    inline explicit operator bool() const
+    {
+      return offset_ != null_offset;
+    }
+
+    inline global_ptr operator+(std::ptrdiff_t n) const
+    {
+      global_ptr result = *this;
+      return result += n;
+    }
+
+    inline global_ptr operator-(std::ptrdiff_t n) const
+    {
+      global_ptr result = *this;
+      return result -= n;
+    }
+
+    inline global_ptr& operator+=(std::ptrdiff_t n)
+    {
+      offset_ += n * static_cast<std::ptrdiff_t>(sizeof(T));
+      return *this;
+    }
+
+    inline global_ptr& operator-=(std::ptrdiff_t n)
+    {
+      offset_ -= n * static_cast<std::ptrdiff_t>(sizeof(T));
+      return *this;
+    }
+
+    inline global_ptr& operator++()
+    {
+      return *this += 1;
+    }
+
+    inline global_ptr& operator--()
+    {
+      return *this -= 1;
+    }
+
+    inline bool operator==(const global_ptr& other) const
+    {
+      return node_ == other.node_ && offset_ == other.offset_;
+    }
+
+    inline bool operator!=(const global_ptr& other) const
+    {
+      return !(*this == other);
+    }
+
+    template<class OutputArchive>
+    friend void serialize(OutputArchive& ar, const global_ptr& self)
+    {
+      ar(self.node_, self.offset_);
+    }
+
+    template<class InputArchive>
+    friend void deserialize(InputArchive& ar, global_ptr& self)
+    {
+      ar(self.node_, self.offset_);
+    }
+
+  private:
+    // the owner translates the global_ptr into its own address of the object before calling f
+    template<class Function, class... Args>
+    static invoke_result_t<Function,T*,Args...> invoke_at_owner(Function f, global_ptr self, Args... args)
+    {
+      return f(self.get_address(), std::move(args)...);
+    }
+
+    static constexpr std::ptrdiff_t null_offset = std::numeric_limits<std::ptrdiff_t>::min();
+
+    std::size_t node_;
+
+    // the offset of the referenced object from execution_context::symmetric_heap_base()
+    std::ptrdiff_t offset_;
+};
@@ -0,0 +1,231 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+#include <tuple>
+
+#include "serialization.hpp"
+#include "active_message.hpp"
+
+
+// define ACTIVE_MESSAGE_HANDLER_TABLE_CAPACITY to change the number of handler ids, including the closure handler's
+#ifndef ACTIVE_MESSAGE_HANDLER_TABLE_CAPACITY
+#define ACTIVE_MESSAGE_HANDLER_TABLE_CAPACITY 256
+#endif
+
+
+// handler_table maps the handler id in each message's header to the functions which activate the message
+// it is a dense array indexed by id, so dispatching a message is a load and an indirect call rather than a switch
+// id 0 is the serializable_closure handler, which activates every message not sent to a registered handler
+class handler_table
+{
+  public:
+    // activates a message's body, whose arguments are for function
+    using activation = any (*)(void* function, const char* body, std::size_t size);
+
+    struct entry
+    {
+      // activate one-sided and two-sided requests; the result of a two-sided request is its reply
+      activation one_sided;
+      activation two_sided;
+
+      // the registered function, which its activations invoke
+      std::shared_ptr<void> function;
+    };
+
+    static constexpr std::size_t capacity = ACTIVE_MESSAGE_HANDLER_TABLE_CAPACITY;
+
+    static_assert(capacity <= 1 << 16, "handler_table: Handler ids must fit in a message_header's 16-bit handler field.");
+
+    static const std::size_t closure_handler_id = 0;
+
+    inline handler_table()
+      : entries_(new entry[capacity + 1])
+    {
+      // the extra entry stands for every id beyond the table
+      std::fill(entries_.get(), entries_.get() + capacity + 1, unregistered_entry());
+
+      entries_[closure_handler_id] = entry{&activate_closure, &activate_closure, nullptr};
+    }
+
+    // registers e under id
+    inline void insert(std::size_t id, entry e)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if(id == closure_handler_id || id >= capacity)
+      {
+        throw std::runtime_error("handler_table::insert(): Handler id out of range.");
+      }
+
+      if(is_registered(id))
+      {
+        throw std::runtime_error("handler_table::insert(): Handler id is already registered.");
+      }
+
+      entries_[id] = std::move(e);
+    }
+
+    // registers e under the lowest free id and returns it
+    inline std::size_t insert(entry e)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      for(std::size_t id = closure_handler_id + 1; id < capacity; ++id)
+      {
+        if(!is_registered(id))
+        {
+          entries_[id] = std::move(e);
+          return id;
+        }
+      }
+
+      throw std::runtime_error("handler_table::insert(): Handler table is full.");
+    }
+
+    // ids which have no handler, including those beyond the table, have an entry whose activations throw
+    // handlers must be registered before messages are sent to them, so lookups needn't lock
+    inline const entry& operator[](std::size_t id) const
+    {
+      // the clamp compiles to a conditional move rather than a branch
+      return entries_[id < capacity ? id : capacity];
+    }
+
+  private:
+    inline bool is_registered(std::size_t id) const
+    {
+      return entries_[id].one_sided != &activate_unregistered;
+    }
+
+    inline static any activate_closure(void*, const char* body, std::size_t size)
+    {
+      return active_message::activate_serialization(body, size);
+    }
+
+    inline static any activate_unregistered(void*, const char*, std::size_t)
+    {
+      throw std::runtime_error("handler_table: Received a message for a handler which was not registered.");
+    }
+
+    inline static entry unregistered_entry()
+    {
+      return entry{&activate_unregistered, &activate_unregistered, nullptr};
+    }
+
+    std::mutex mutex_;
+    std::unique_ptr<entry[]> entries_;
+};
+
+
+// registered_handler<Result(Args...)> names a function registered with execution_context::register_handler
+// messages sent through it carry only its id and arguments, which the receiver decodes and passes
+// straight to the function rather than through a serializable_closure
+template<class Signature>
+class registered_handler;
+
+template<class Result, class... Args>
+class registered_handler<Result(Args...)>
+{
+  public:
+    using result_type = Result;
+
+    using arguments_type = std::tuple<typename std::decay<Args>::type...>;
+
+    // sender and receiver check that they agree on the handler's signature
+    using fingerprint = type_fingerprint<Result(*)(typename std::decay<Args>::type...)>;
+
+    inline std::size_t id() const
+    {
+      return id_;
+    }
+
+  private:
+    friend class execution_context;
+
+    using invoke_function = Result (*)(void* function, typename std::decay<Args>::type&... args);
+
+    inline registered_handler(std::size_t id, invoke_function invoke, void* function)
+      : id_(id),
+        invoke_(invoke),
+        function_(function)
+    {}
+
+    // invokes the function registered on this node, which messages to this node needn't be serialized to reach
+    inline invoke_function invoke() const
+    {
+      return invoke_;
+    }
+
+    inline void* function() const
+    {
+      return function_;
+    }
+
+    std::size_t id_;
+    invoke_function invoke_;
+    void* function_;
+};
+
+
+// is_registrable<Function,Signature> is true when Function can be registered as the handler of messages whose arguments are Signature's
+template<class Function, class Signature>
+struct is_registrable : std::false_type {};
+
+template<class Function, class Result, class... Args>
+struct is_registrable<Function, Result(Args...)>
+  : conjunction<
+      can_serialize_all<typename std::decay<Args>::type...>,
+      can_deserialize_all<typename std::decay<Args>::type...>,
+      is_invocable<Function&, typename std::decay<Args>::type...>
+    >
+{};
+
+
+template<class Params, class Args, bool = (std::tuple_size<Params>::value == std::tuple_size<Args>::value)>
+struct can_send_impl : std::false_type {};
+
+template<class... Params, class... Args>
+struct can_send_impl<std::tuple<Params...>, std::tuple<Args...>, true>
+  : conjunction<std::is_convertible<Args, typename std::decay<Params>::type>...>
+{};
+
+// can_send<Handler,Args...> is true when args... can be sent to the registered_handler Handler
+template<class Handler, class... Args>
+struct can_send : std::false_type {};
+
+template<class Result, class... Params, class... Args>
+struct can_send<registered_handler<Result(Params...)>, Args...>
+  : can_send_impl<std::tuple<Params...>, std::tuple<Args...>>
+{};
+
@@ -0,0 +1,121 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// $ ./openshmem-am-root/bin/oshc++ -std=c++11 handlers.cpp 
+// $ ./openshmem-am-root/bin/oshrun ./a.out -n 2
+// PE 0: add and scale registered under ids 1 and 2
+// PE 1: Hello, world with value 7!
+// PE 0: add(6, 7) returned 13
+// PE 0: scale(3, 4) returned 12
+// PE 0: Mismatched signatures reported: execution_context: Type fingerprint mismatch. Did every node register the same handlers under the same ids?
+
+#include <iostream>
+#include <future>
+#include <string>
+#include <cassert>
+
+#include "execution_context.hpp"
+
+
+void hello_world(int value)
+{
+  std::cout << "PE " << shmem_my_pe() << ": Hello, world with value " << value << "!" << std::endl;
+}
+
+int negate(int value)
+{
+  return -value;
+}
+
+int length(std::string value)
+{
+  return static_cast<int>(value.size());
+}
+
+int main()
+{
+  execution_context& ctx = system_context();
+
+  // every node registers these in the same order, so each node assigns them the same ids
+  auto add = ctx.register_handler<int(int,int)>([](int x, int y)
+  {
+    return x + y;
+  });
+
+  auto scale = ctx.register_handler<int(int,int)>([](int x, int factor)
+  {
+    return x * factor;
+  });
+
+  assert(add.id() == 1);
+  assert(scale.id() == 2);
+
+  // handlers may also be registered under an id of the caller's choosing
+  auto hello = ctx.register_handler(100, hello_world);
+  assert(hello.id() == 100);
+
+  if(shmem_my_pe() == 0)
+  {
+    // node 0 registers a different signature under id 101 than every other node does
+    auto mismatched = ctx.register_handler(101, negate);
+
+    // handlers must be registered on every node before messages are sent to them
+    shmem_barrier_all();
+
+    std::cout << "PE 0: add and scale registered under ids " << add.id() << " and " << scale.id() << std::endl;
+
+    ctx.one_sided_execute(1, hello, 7);
+
+    int sum = ctx.two_sided_execute(1, add, 6, 7).get();
+    assert(sum == 13);
+    std::cout << "PE 0: add(6, 7) returned " << sum << std::endl;
+
+    int product = ctx.two_sided_execute(1, scale, 3, 4).get();
+    assert(product == 12);
+    std::cout << "PE 0: scale(3, 4) returned " << product << std::endl;
+
+    // node 1 expects a std::string rather than an int, so it rejects the request rather than misread its argument
+    try
+    {
+      ctx.two_sided_execute(1, mismatched, 7).get();
+      assert(false);
+    }
+    catch(const remote_error& e)
+    {
+      std::cout << "PE 0: Mismatched signatures reported: " << e.what() << std::endl;
+    }
+
+    ctx.wait_for_all();
+  }
+  else
+  {
+    ctx.register_handler(101, length);
+
+    shmem_barrier_all();
+  }
+
+  shmem_barrier_all();
+}
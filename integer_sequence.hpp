@@ -44,41 +44,74 @@ template<size_t... _Ip>
 using index_sequence = integer_sequence<size_t, _Ip...>;
 
 
+// make_integer_sequence uses the compiler's builtin when there is one, so that it instantiates no templates per element
+// otherwise, it halves _Ep at each step, so a sequence of length N instantiates O(log N) templates rather than O(N)
+#if defined(__has_builtin)
+#  if __has_builtin(__make_integer_seq)
+#    define INTEGER_SEQUENCE_HAS_MAKE_INTEGER_SEQ
+#  elif __has_builtin(__integer_pack)
+#    define INTEGER_SEQUENCE_HAS_INTEGER_PACK
+#  endif
+#endif
+
+
 namespace detail
 {
 
-template <class _Tp, _Tp _Sp, _Tp _Ep, class _IntSequence>
-struct make_integer_sequence_unchecked;
 
-template <class _Tp, _Tp _Sp, _Tp _Ep, _Tp ..._Indices>
-struct make_integer_sequence_unchecked<_Tp, _Sp, _Ep,
-                                       integer_sequence<_Tp, _Indices...>>
+#if !defined(INTEGER_SEQUENCE_HAS_MAKE_INTEGER_SEQ) && !defined(INTEGER_SEQUENCE_HAS_INTEGER_PACK)
+
+template <class _Tp, class _Sequence1, class _Sequence2>
+struct concatenate_integer_sequences;
+
+// the second sequence's indices are offset by the length of the first
+template <class _Tp, _Tp ..._Indices1, _Tp ..._Indices2>
+struct concatenate_integer_sequences<_Tp, integer_sequence<_Tp, _Indices1...>, integer_sequence<_Tp, _Indices2...>>
+{
+  typedef integer_sequence<_Tp, _Indices1..., (sizeof...(_Indices1) + _Indices2)...> type;
+};
+
+
+template <class _Tp, _Tp _Ep, class _Enable = void>
+struct make_integer_sequence_unchecked
 {
-  typedef typename make_integer_sequence_unchecked<
-    _Tp, _Sp+1, _Ep,
-    integer_sequence<_Tp, _Indices..., _Sp>
+  typedef typename concatenate_integer_sequences<
+    _Tp,
+    typename make_integer_sequence_unchecked<_Tp, _Ep / 2>::type,
+    typename make_integer_sequence_unchecked<_Tp, _Ep - _Ep / 2>::type
   >::type type;
 };
 
 
-template <class _Tp, _Tp _Ep, _Tp ..._Indices>
-struct make_integer_sequence_unchecked<_Tp, _Ep, _Ep,
-                                       integer_sequence<_Tp, _Indices...>>
+template <class _Tp, _Tp _Ep>
+struct make_integer_sequence_unchecked<_Tp, _Ep, typename std::enable_if<_Ep <= 0>::type>
 {
-  typedef integer_sequence<_Tp, _Indices...> type;
+  typedef integer_sequence<_Tp> type;
 };
 
 
+template <class _Tp, _Tp _Ep>
+struct make_integer_sequence_unchecked<_Tp, _Ep, typename std::enable_if<_Ep == 1>::type>
+{
+  typedef integer_sequence<_Tp, 0> type;
+};
+
+#endif
+
+
 template <class _Tp, _Tp _Ep>
 struct make_integer_sequence
 {
   static_assert(std::is_integral<_Tp>::value,
                 "std::make_integer_sequence can only be instantiated with an integral type" );
   static_assert(0 <= _Ep, "std::make_integer_sequence input shall not be negative");
-  typedef typename make_integer_sequence_unchecked
-                   <
-                      _Tp, 0, _Ep, integer_sequence<_Tp>
-                   >::type type;
+#if defined(INTEGER_SEQUENCE_HAS_MAKE_INTEGER_SEQ)
+  typedef __make_integer_seq<integer_sequence, _Tp, _Ep> type;
+#elif defined(INTEGER_SEQUENCE_HAS_INTEGER_PACK)
+  typedef integer_sequence<_Tp, __integer_pack(_Ep)...> type;
+#else
+  typedef typename make_integer_sequence_unchecked<_Tp, _Ep>::type type;
+#endif
 };
 
 
@@ -80,7 +80,7 @@ class process_context
       std::lock_guard<std::mutex> lock(mutex_);
 
       // create an active_message out of f
-      active_message message(decay_copy(std::forward<Function>(f)));
+      active_message message(std::forward<Function>(f));
 
       // make a copy of this process's environment and set the variable ALTERNATE_MAIN_ACTIVE_MESSAGE to contain serialized message
       auto spawnee_environment = this_process::environment();
@@ -153,12 +153,6 @@ class process_context
       return result;
     }
 
-    template<class Arg>
-    static typename std::decay<Arg>::type decay_copy(Arg&& arg)
-    {
-      return std::forward<Arg>(arg);
-    }
-
     std::mutex mutex_;
     std::vector<pid_t> processes_;
 };
@@ -28,7 +28,35 @@
 
 #include "serialization.hpp"
 #include "execution_context.hpp"
+#include "integer_sequence.hpp"
 #include <stdexcept>
+#include <future>
+#include <memory>
+#include <vector>
+#include <tuple>
+#include <chrono>
+
+
+// the type of f(predecessor.get(), args...), or of f(args...) when the predecessor is a std::future<void>
+template<class Function, class T, class... Args>
+struct then_execute_result
+{
+  using type = invoke_result_t<Function,T,Args...>;
+};
+
+template<class Function, class... Args>
+struct then_execute_result<Function,void,Args...>
+{
+  using type = invoke_result_t<Function,Args...>;
+};
+
+
+// whether f(predecessor.get(), args...), or f(args...) when the predecessor is a std::future<void>, is well-formed
+template<class Function, class T, class... Args>
+struct is_then_invocable : is_invocable<Function,T,Args...> {};
+
+template<class Function, class... Args>
+struct is_then_invocable<Function,void,Args...> : is_invocable<Function,Args...> {};
 
 
 // XXX since it's legal to create a remote_executor referring to one's own node (i.e., the local node),
@@ -54,15 +82,91 @@ class remote_executor
       return system_context();
     }
 
-    template<class Function,
-             __REQUIRES(can_serialize<typename std::decay<Function>::type>::value),
-             __REQUIRES(can_deserialize<typename std::decay<Function>::type>::value),
-             __REQUIRES(is_invocable<typename std::decay<Function>::type>::value)
+    // executes f(args...) on node() without returning a result
+    // this sends a one-sided message, so no reply is needed
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    submission_status execute(Function&& f, Args&&... args) const
+    {
+      return context().one_sided_execute(node(), std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    std::future<invoke_result_t<typename std::decay<Function>::type,typename std::decay<Args>::type...>>
+      twoway_execute(Function&& f, Args&&... args) const
+    {
+      return context().two_sided_execute(node(), std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    // executes f(i, args...) on node() for each i in [0, shape) without returning a result
+    // the whole group travels in a single one-sided message
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,std::size_t,typename std::decay<Args>::type...>::value)
+            >
+    submission_status bulk_execute(Function&& f, std::size_t shape, Args&&... args) const
+    {
+      return context().one_sided_execute(node(),
+        &bulk_invoke<typename std::decay<Function>::type,typename std::decay<Args>::type...>,
+        std::forward<Function>(f), shape, std::forward<Args>(args)...
+      );
+    }
+
+    // executes f(i, args...) on node() for each i in [0, shape) and returns a future for the vector of their results
+    // the whole group travels in a single two-sided message
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,std::size_t,typename std::decay<Args>::type...>::value),
+             class Result = invoke_result_t<typename std::decay<Function>::type,std::size_t,typename std::decay<Args>::type...>,
+             __REQUIRES(!std::is_void<Result>::value)
+            >
+    std::future<std::vector<Result>>
+      bulk_twoway_execute(Function&& f, std::size_t shape, Args&&... args) const
+    {
+      return context().two_sided_execute(node(),
+        &bulk_invoke_and_collect<Result,typename std::decay<Function>::type,typename std::decay<Args>::type...>,
+        std::forward<Function>(f), shape, std::forward<Args>(args)...
+      );
+    }
+
+    // once predecessor is ready, executes f(predecessor.get(), args...) on node() and returns a future for its result
+    // (or f(args...) when predecessor is a std::future<void>)
+    // predecessor is consumed
+    // no thread blocks on predecessor: the polling thread sends the request when predecessor becomes ready
+    // wait_for_all() waits for this continuation until its reply arrives, and continuations and handlers run on the
+    // polling thread, so calling wait_for_all() from f, or from any other continuation or handler, deadlocks
+    template<class Function, class T, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_then_invocable<typename std::decay<Function>::type,T,typename std::decay<Args>::type...>::value),
+             class Result = typename then_execute_result<typename std::decay<Function>::type,T,typename std::decay<Args>::type...>::type
             >
-    std::future<invoke_result_t<typename std::decay<Function>::type>>
-      twoway_execute(Function&& f) const
+    std::future<Result>
+      then_execute(Function&& f, std::future<T>& predecessor, Args&&... args) const
     {
-      return context().two_sided_execute(node(), std::forward<Function>(f));
+      using continuation_type = then_continuation<Result,typename std::decay<Function>::type,T,typename std::decay<Args>::type...>;
+
+      std::shared_ptr<continuation_type> continuation = std::make_shared<continuation_type>(
+        node(), std::forward<Function>(f), std::move(predecessor), std::forward<Args>(args)...
+      );
+
+      std::future<Result> result = continuation->promise.get_future();
+
+      context().add_continuation([continuation]
+      {
+        return (*continuation)();
+      });
+
+      return result;
     }
 
     inline std::size_t node() const
@@ -71,6 +175,91 @@ class remote_executor
     }
 
   private:
+    template<class Function, class... Args>
+    static void bulk_invoke(Function f, std::size_t shape, Args... args)
+    {
+      for(std::size_t i = 0; i < shape; ++i)
+      {
+        f(i, args...);
+      }
+    }
+
+    template<class Result, class Function, class... Args>
+    static std::vector<Result> bulk_invoke_and_collect(Function f, std::size_t shape, Args... args)
+    {
+      std::vector<Result> result;
+      result.reserve(shape);
+
+      for(std::size_t i = 0; i < shape; ++i)
+      {
+        result.push_back(f(i, args...));
+      }
+
+      return result;
+    }
+
+    template<class T>
+    static bool is_ready(const std::future<T>& future)
+    {
+      return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // the polling thread calls a then_continuation until it returns true:
+    // first it waits for the predecessor and sends the request, then it waits for the reply
+    template<class Result, class Function, class T, class... Args>
+    struct then_continuation
+    {
+      std::size_t node;
+      Function f;
+      std::future<T> predecessor;
+      std::tuple<Args...> args;
+      std::future<Result> reply;
+      std::promise<Result> promise;
+
+      template<class OtherFunction, class... OtherArgs>
+      then_continuation(std::size_t node, OtherFunction&& f, std::future<T>&& predecessor, OtherArgs&&... args)
+        : node(node),
+          f(std::forward<OtherFunction>(f)),
+          predecessor(std::move(predecessor)),
+          args(std::forward<OtherArgs>(args)...)
+      {}
+
+      bool operator()()
+      {
+        try
+        {
+          if(!reply.valid())
+          {
+            if(!is_ready(predecessor)) return false;
+
+            reply = send(std::is_void<T>(), make_index_sequence<sizeof...(Args)>());
+          }
+
+          if(!is_ready(reply)) return false;
+
+          promise.set_value(reply.get());
+        }
+        catch(...)
+        {
+          promise.set_exception(std::current_exception());
+        }
+
+        return true;
+      }
+
+      template<size_t... Indices>
+      std::future<Result> send(std::false_type /* void predecessor */, index_sequence<Indices...>)
+      {
+        return system_context().two_sided_execute(node, f, predecessor.get(), std::get<Indices>(args)...);
+      }
+
+      template<size_t... Indices>
+      std::future<Result> send(std::true_type /* void predecessor */, index_sequence<Indices...>)
+      {
+        predecessor.get();
+        return system_context().two_sided_execute(node, f, std::get<Indices>(args)...);
+      }
+    };
+
     std::size_t node_;
 };
-
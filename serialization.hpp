@@ -32,7 +32,23 @@
 #include <typeinfo>
 #include <sstream>
 #include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cctype>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <limits>
+#if __cplusplus >= 201703L
+#include <optional>
+#endif
 #include "string_view_stream.hpp"
+#include "array_stream.hpp"
+#include "small_buffer.hpp"
+#include "string_output_stream.hpp"
 #include "tuple.hpp"
 
 
@@ -57,11 +73,29 @@ void serialize(OutputArchive& ar, Result (*const &fun_ptr)(Args...))
   serialize(ar, void_ptr);
 }
 
+// a length prefix is a formatted length followed by a single space
+// runs of raw bytes must follow a length prefix: deserialize_length() consumes exactly one
+// space after the length, which leaves any whitespace at the beginning of the bytes intact
+template<class OutputArchive>
+void serialize_length(OutputArchive& ar, std::size_t length)
+{
+  ar.stream() << length << " ";
+}
+
+template<class InputArchive>
+std::size_t deserialize_length(InputArchive& ar)
+{
+  std::size_t result = 0;
+  ar.stream() >> result;
+  ar.stream().get();
+  return result;
+}
+
 template<class OutputArchive>
 void serialize(OutputArchive& ar, const std::string& s)
 {
   // output the length
-  serialize(ar, s.size());
+  serialize_length(ar, s.size());
 
   // output the bytes
   ar.stream().write(s.data(), s.size());
@@ -75,6 +109,77 @@ void deserialize(InputArchive& ar, T& value)
   ar.stream() >> value >> std::ws;
 }
 
+
+// floating point numbers are written with enough digits to survive the round trip
+template<class OutputArchive, class T>
+void serialize_floating_point(OutputArchive& ar, T value)
+{
+  std::streamsize old_precision = ar.stream().precision(std::numeric_limits<T>::max_digits10);
+  ar.stream() << value << " ";
+  ar.stream().precision(old_precision);
+}
+
+// operator>> allocates while it parses floating point numbers, so parse them ourselves
+template<class InputArchive, class T>
+void deserialize_floating_point(InputArchive& ar, T& value, T (*convert)(const char*, char**))
+{
+  std::istream& is = ar.stream() >> std::ws;
+
+  char digits[64];
+  std::size_t n = 0;
+  while(n + 1 < sizeof(digits) && is.peek() != std::istream::traits_type::eof() && !std::isspace(is.peek()))
+  {
+    digits[n++] = static_cast<char>(is.get());
+  }
+  digits[n] = 0;
+
+  char* end = nullptr;
+  value = convert(digits, &end);
+
+  if(n == 0 || end != digits + n)
+  {
+    throw std::runtime_error("deserialize(): Malformed floating point number.");
+  }
+
+  is >> std::ws;
+}
+
+template<class OutputArchive>
+void serialize(OutputArchive& ar, const float& value)
+{
+  serialize_floating_point(ar, value);
+}
+
+template<class OutputArchive>
+void serialize(OutputArchive& ar, const double& value)
+{
+  serialize_floating_point(ar, value);
+}
+
+template<class OutputArchive>
+void serialize(OutputArchive& ar, const long double& value)
+{
+  serialize_floating_point(ar, value);
+}
+
+template<class InputArchive>
+void deserialize(InputArchive& ar, float& value)
+{
+  deserialize_floating_point(ar, value, &std::strtof);
+}
+
+template<class InputArchive>
+void deserialize(InputArchive& ar, double& value)
+{
+  deserialize_floating_point(ar, value, &std::strtod);
+}
+
+template<class InputArchive>
+void deserialize(InputArchive& ar, long double& value)
+{
+  deserialize_floating_point(ar, value, &std::strtold);
+}
+
 template<class InputArchive, class T,
          __REQUIRES(!std::is_void<T>::value)>
 void deserialize(InputArchive& ar, T*& ptr)
@@ -96,12 +201,56 @@ void deserialize(InputArchive& ar, Result (*&fun_ptr)(Args...))
 }
 
 
+// member function pointers are serialized as their object representation,
+// which, like function pointers, assumes that every node runs the same program
+template<class OutputArchive, class MemberFunctionPtr>
+void serialize_member_function_ptr(OutputArchive& ar, const MemberFunctionPtr& ptr)
+{
+  serialize_length(ar, sizeof(ptr));
+  ar.stream().write(reinterpret_cast<const char*>(&ptr), sizeof(ptr));
+}
+
+template<class InputArchive, class MemberFunctionPtr>
+void deserialize_member_function_ptr(InputArchive& ar, MemberFunctionPtr& ptr)
+{
+  if(deserialize_length(ar) != sizeof(ptr))
+  {
+    throw std::runtime_error("deserialize(): Unexpected member function pointer size.");
+  }
+
+  ar.stream().read(reinterpret_cast<char*>(&ptr), sizeof(ptr));
+}
+
+template<class OutputArchive, class Result, class Class, class... Args>
+void serialize(OutputArchive& ar, Result (Class::*const &mem_fun_ptr)(Args...))
+{
+  serialize_member_function_ptr(ar, mem_fun_ptr);
+}
+
+template<class OutputArchive, class Result, class Class, class... Args>
+void serialize(OutputArchive& ar, Result (Class::*const &mem_fun_ptr)(Args...) const)
+{
+  serialize_member_function_ptr(ar, mem_fun_ptr);
+}
+
+template<class InputArchive, class Result, class Class, class... Args>
+void deserialize(InputArchive& ar, Result (Class::*&mem_fun_ptr)(Args...))
+{
+  deserialize_member_function_ptr(ar, mem_fun_ptr);
+}
+
+template<class InputArchive, class Result, class Class, class... Args>
+void deserialize(InputArchive& ar, Result (Class::*&mem_fun_ptr)(Args...) const)
+{
+  deserialize_member_function_ptr(ar, mem_fun_ptr);
+}
+
+
 template<class InputArchive>
 void deserialize(InputArchive& ar, std::string& s)
 {
   // read the length and resize the string
-  std::size_t length = 0;
-  deserialize(ar, length);
+  std::size_t length = deserialize_length(ar);
   s.resize(length);
 
   // read characters from the stream
@@ -109,50 +258,601 @@ void deserialize(InputArchive& ar, std::string& s)
 }
 
 
-template<size_t Index, class OutputArchive, class... Ts, __REQUIRES(Index == sizeof...(Ts))>
-void serialize_tuple_impl(OutputArchive& ar, const std::tuple<Ts...>& tuple)
+// is_bitwise_serializable<T> indicates that contiguous ranges of T may be serialized as a single run of raw bytes
+// specialize it for user-defined types whose object representation is meaningful on every node
+template<class T>
+struct is_bitwise_serializable : std::integral_constant<bool, std::is_arithmetic<T>::value || std::is_enum<T>::value> {};
+
+
+// containers
+// these are declared before they are defined so that they may contain one another
+
+template<class OutputArchive, class T1, class T2>
+void serialize(OutputArchive& ar, const std::pair<T1,T2>& p);
+
+template<class InputArchive, class T1, class T2>
+void deserialize(InputArchive& ar, std::pair<T1,T2>& p);
+
+template<class OutputArchive, class T, class Alloc>
+void serialize(OutputArchive& ar, const std::vector<T,Alloc>& v);
+
+template<class InputArchive, class T, class Alloc>
+void deserialize(InputArchive& ar, std::vector<T,Alloc>& v);
+
+template<class OutputArchive, class T, std::size_t N>
+void serialize(OutputArchive& ar, const std::array<T,N>& a);
+
+template<class InputArchive, class T, std::size_t N>
+void deserialize(InputArchive& ar, std::array<T,N>& a);
+
+template<class OutputArchive, class T, std::size_t N>
+void serialize(OutputArchive& ar, const T (&a)[N]);
+
+template<class InputArchive, class T, std::size_t N>
+void deserialize(InputArchive& ar, T (&a)[N]);
+
+template<class OutputArchive, class Key, class T, class Compare, class Alloc>
+void serialize(OutputArchive& ar, const std::map<Key,T,Compare,Alloc>& m);
+
+template<class InputArchive, class Key, class T, class Compare, class Alloc>
+void deserialize(InputArchive& ar, std::map<Key,T,Compare,Alloc>& m);
+
+template<class OutputArchive, class Key, class T, class Hash, class KeyEqual, class Alloc>
+void serialize(OutputArchive& ar, const std::unordered_map<Key,T,Hash,KeyEqual,Alloc>& m);
+
+template<class InputArchive, class Key, class T, class Hash, class KeyEqual, class Alloc>
+void deserialize(InputArchive& ar, std::unordered_map<Key,T,Hash,KeyEqual,Alloc>& m);
+
+#if __cplusplus >= 201703L
+template<class OutputArchive, class T>
+void serialize(OutputArchive& ar, const std::optional<T>& o);
+
+template<class InputArchive, class T>
+void deserialize(InputArchive& ar, std::optional<T>& o);
+#endif
+
+
+// contiguous ranges are a length prefix followed by either a single run of bytes
+// or, when the element type is not bitwise serializable, each element in turn
+
+template<class OutputArchive, class T>
+void serialize_contiguous_range(OutputArchive& ar, const T* data, std::size_t n, std::true_type /* bitwise */)
+{
+  serialize_length(ar, n);
+  ar.stream().write(reinterpret_cast<const char*>(data), n * sizeof(T));
+}
+
+template<class OutputArchive, class T>
+void serialize_contiguous_range(OutputArchive& ar, const T* data, std::size_t n, std::false_type /* bitwise */)
+{
+  serialize_length(ar, n);
+
+  // stop once the stream fails, e.g. because a fixed-size buffer is full
+  for(std::size_t i = 0; i < n && ar.stream(); ++i)
+  {
+    serialize(ar, data[i]);
+  }
+}
+
+template<class OutputArchive, class T>
+void serialize_contiguous_range(OutputArchive& ar, const T* data, std::size_t n)
 {
+  serialize_contiguous_range(ar, data, n, is_bitwise_serializable<T>());
 }
 
-template<size_t Index, class OutputArchive, class... Ts, __REQUIRES(Index < sizeof...(Ts))>
-void serialize_tuple_impl(OutputArchive& ar, const std::tuple<Ts...>& tuple)
+
+// deserializes a fixed-length range; the length prefix must match
+template<class InputArchive, class T>
+void deserialize_contiguous_range(InputArchive& ar, T* data, std::size_t n, std::true_type /* bitwise */)
 {
-  serialize(ar, std::get<Index>(tuple));
-  serialize_tuple_impl<Index+1>(ar, tuple);
+  if(deserialize_length(ar) != n)
+  {
+    throw std::runtime_error("deserialize(): Unexpected array length.");
+  }
+
+  ar.stream().read(reinterpret_cast<char*>(data), n * sizeof(T));
 }
 
-template<class OutputArchive, class... Ts>
-void serialize(OutputArchive& ar, const std::tuple<Ts...>& tuple)
+template<class InputArchive, class T>
+void deserialize_contiguous_range(InputArchive& ar, T* data, std::size_t n, std::false_type /* bitwise */)
+{
+  if(deserialize_length(ar) != n)
+  {
+    throw std::runtime_error("deserialize(): Unexpected array length.");
+  }
+
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    deserialize(ar, data[i]);
+  }
+}
+
+template<class InputArchive, class T>
+void deserialize_contiguous_range(InputArchive& ar, T* data, std::size_t n)
+{
+  deserialize_contiguous_range(ar, data, n, is_bitwise_serializable<T>());
+}
+
+
+template<class OutputArchive, class T1, class T2>
+void serialize(OutputArchive& ar, const std::pair<T1,T2>& p)
 {
-  serialize_tuple_impl<0>(ar, tuple);
+  serialize(ar, p.first);
+  serialize(ar, p.second);
+}
+
+template<class InputArchive, class T1, class T2>
+void deserialize(InputArchive& ar, std::pair<T1,T2>& p)
+{
+  deserialize(ar, p.first);
+  deserialize(ar, p.second);
 }
 
 
-template<size_t Index, class InputArchive, class... Ts, __REQUIRES(Index == sizeof...(Ts))>
-void deserialize_tuple_impl(InputArchive& ar, std::tuple<Ts...>& tuple)
+template<class OutputArchive, class T, class Alloc>
+void serialize_vector(OutputArchive& ar, const std::vector<T,Alloc>& v, std::true_type /* bitwise */)
 {
+  serialize_contiguous_range(ar, v.data(), v.size(), std::true_type());
 }
 
-template<size_t Index, class InputArchive, class... Ts, __REQUIRES(Index < sizeof...(Ts))>
-void deserialize_tuple_impl(InputArchive& ar, std::tuple<Ts...>& tuple)
+template<class OutputArchive, class T, class Alloc>
+void serialize_vector(OutputArchive& ar, const std::vector<T,Alloc>& v, std::false_type /* bitwise */)
 {
-  deserialize(ar, std::get<Index>(tuple));
-  deserialize_tuple_impl<Index+1>(ar, tuple);
+  // this also handles std::vector<bool>, which is not contiguous
+  serialize_length(ar, v.size());
+
+  for(auto i = v.begin(); i != v.end() && ar.stream(); ++i)
+  {
+    serialize(ar, static_cast<const T&>(*i));
+  }
+}
+
+template<class OutputArchive, class T, class Alloc>
+void serialize(OutputArchive& ar, const std::vector<T,Alloc>& v)
+{
+  using bitwise = std::integral_constant<bool, is_bitwise_serializable<T>::value && !std::is_same<T,bool>::value>;
+  serialize_vector(ar, v, bitwise());
+}
+
+template<class InputArchive, class T, class Alloc>
+void deserialize_vector(InputArchive& ar, std::vector<T,Alloc>& v, std::true_type /* bitwise */)
+{
+  // allocate storage for every element, then read them all at once
+  std::size_t length = deserialize_length(ar);
+  v.resize(length);
+
+  ar.stream().read(reinterpret_cast<char*>(v.data()), length * sizeof(T));
+}
+
+template<class InputArchive, class T, class Alloc>
+void deserialize_vector(InputArchive& ar, std::vector<T,Alloc>& v, std::false_type /* bitwise */)
+{
+  std::size_t length = deserialize_length(ar);
+
+  v.clear();
+  v.reserve(length);
+
+  for(std::size_t i = 0; i < length; ++i)
+  {
+    T element;
+    deserialize(ar, element);
+    v.push_back(std::move(element));
+  }
+}
+
+template<class InputArchive, class T, class Alloc>
+void deserialize(InputArchive& ar, std::vector<T,Alloc>& v)
+{
+  using bitwise = std::integral_constant<bool, is_bitwise_serializable<T>::value && !std::is_same<T,bool>::value>;
+  deserialize_vector(ar, v, bitwise());
+}
+
+
+template<class OutputArchive, class T, std::size_t N>
+void serialize(OutputArchive& ar, const std::array<T,N>& a)
+{
+  serialize_contiguous_range(ar, a.data(), N);
+}
+
+template<class InputArchive, class T, std::size_t N>
+void deserialize(InputArchive& ar, std::array<T,N>& a)
+{
+  deserialize_contiguous_range(ar, a.data(), N);
+}
+
+
+template<class OutputArchive, class T, std::size_t N>
+void serialize(OutputArchive& ar, const T (&a)[N])
+{
+  serialize_contiguous_range(ar, &a[0], N);
+}
+
+template<class InputArchive, class T, std::size_t N>
+void deserialize(InputArchive& ar, T (&a)[N])
+{
+  deserialize_contiguous_range(ar, &a[0], N);
+}
+
+
+template<class OutputArchive, class Map>
+void serialize_map(OutputArchive& ar, const Map& m)
+{
+  serialize_length(ar, m.size());
+
+  for(auto i = m.begin(); i != m.end() && ar.stream(); ++i)
+  {
+    const auto& key_and_value = *i;
+    serialize(ar, key_and_value.first);
+    serialize(ar, key_and_value.second);
+  }
+}
+
+template<class InputArchive, class Map>
+void deserialize_map_elements(InputArchive& ar, Map& m, std::size_t length)
+{
+  for(std::size_t i = 0; i < length; ++i)
+  {
+    typename Map::key_type key;
+    typename Map::mapped_type value;
+    deserialize(ar, key);
+    deserialize(ar, value);
+
+    m.emplace_hint(m.end(), std::move(key), std::move(value));
+  }
+}
+
+template<class OutputArchive, class Key, class T, class Compare, class Alloc>
+void serialize(OutputArchive& ar, const std::map<Key,T,Compare,Alloc>& m)
+{
+  serialize_map(ar, m);
+}
+
+template<class InputArchive, class Key, class T, class Compare, class Alloc>
+void deserialize(InputArchive& ar, std::map<Key,T,Compare,Alloc>& m)
+{
+  std::size_t length = deserialize_length(ar);
+
+  // keys arrive in order, so each element is inserted at the end of the map
+  m.clear();
+  deserialize_map_elements(ar, m, length);
+}
+
+template<class OutputArchive, class Key, class T, class Hash, class KeyEqual, class Alloc>
+void serialize(OutputArchive& ar, const std::unordered_map<Key,T,Hash,KeyEqual,Alloc>& m)
+{
+  serialize_map(ar, m);
+}
+
+template<class InputArchive, class Key, class T, class Hash, class KeyEqual, class Alloc>
+void deserialize(InputArchive& ar, std::unordered_map<Key,T,Hash,KeyEqual,Alloc>& m)
+{
+  std::size_t length = deserialize_length(ar);
+
+  m.clear();
+  m.reserve(length);
+  deserialize_map_elements(ar, m, length);
+}
+
+
+#if __cplusplus >= 201703L
+template<class OutputArchive, class T>
+void serialize(OutputArchive& ar, const std::optional<T>& o)
+{
+  serialize(ar, o.has_value());
+
+  if(o)
+  {
+    serialize(ar, *o);
+  }
+}
+
+template<class InputArchive, class T>
+void deserialize(InputArchive& ar, std::optional<T>& o)
+{
+  bool has_value = false;
+  deserialize(ar, has_value);
+
+  if(has_value)
+  {
+    T value;
+    deserialize(ar, value);
+    o = std::move(value);
+  }
+  else
+  {
+    o.reset();
+  }
+}
+#endif
+
+
+// a tuple's elements are expanded into a single call to the archive, rather than recursing once per element
+template<class OutputArchive, class... Ts, size_t... Indices>
+void serialize_tuple_impl(OutputArchive& ar, const std::tuple<Ts...>& tuple, index_sequence<Indices...>)
+{
+  ar(std::get<Indices>(tuple)...);
+}
+
+template<class OutputArchive, class... Ts>
+void serialize(OutputArchive& ar, const std::tuple<Ts...>& tuple)
+{
+  serialize_tuple_impl(ar, tuple, make_index_sequence<sizeof...(Ts)>());
+}
+
+
+template<class InputArchive, class... Ts, size_t... Indices>
+void deserialize_tuple_impl(InputArchive& ar, std::tuple<Ts...>& tuple, index_sequence<Indices...>)
+{
+  ar(std::get<Indices>(tuple)...);
 }
 
 template<class InputArchive, class... Ts>
 void deserialize(InputArchive& ar, std::tuple<Ts...>& tuple)
 {
-  deserialize_tuple_impl<0>(ar, tuple);
+  deserialize_tuple_impl(ar, tuple, make_index_sequence<sizeof...(Ts)>());
+}
+
+// the traits below are computed from their packs with a single expansion rather than by recursing once per element,
+// so that each closure type instantiates a constant number of them
+
+template<bool... Values>
+struct bool_list {};
+
+// all_true<Values...> is true when every one of Values is, which is when shifting them by one changes nothing
+template<bool... Values>
+struct all_true : std::is_same<bool_list<true, Values...>, bool_list<Values..., true>> {};
+
+template<class... Conditions>
+struct conjunction : all_true<Conditions::value...> {};
+
+
+// constant_array<T, Values...>::values lets constexpr functions loop over Values
+template<class T, T... Values>
+struct constant_array
+{
+  // the trailing element keeps the array nonempty
+  static constexpr T values[sizeof...(Values) + 1] = {Values..., T()};
+};
+
+template<class T, T... Values>
+constexpr T constant_array<T,Values...>::values[sizeof...(Values) + 1];
+
+
+constexpr std::size_t sum_sizes(const std::size_t* sizes, std::size_t n)
+{
+  return n == 0 ? 0 : sizes[0] + sum_sizes(sizes + 1, n - 1);
+}
+
+
+// serialized_size_bound<T>::value is the largest number of bytes serialize() produces for a T,
+// when that is known at compile time; otherwise serialized_size_bound<T>::is_bounded is false
+// specialize it for user-defined types whose serializations have a fixed maximum size
+
+template<bool Bounded, std::size_t Bound>
+struct size_bound
+{
+  static constexpr bool is_bounded = Bounded;
+  static constexpr std::size_t value = Bound;
+};
+
+using unbounded_size = size_bound<false, 0>;
+
+
+template<class T, class Enable = void>
+struct serialized_size_bound : unbounded_size {};
+
+
+constexpr std::size_t decimal_digits(std::size_t n)
+{
+  return n < 10 ? 1 : 1 + decimal_digits(n / 10);
+}
+
+
+template<class... Ts>
+struct serialized_size_bound_all
+  : size_bound<
+      all_true<serialized_size_bound<Ts>::is_bounded...>::value,
+      sum_sizes(constant_array<std::size_t, serialized_size_bound<Ts>::value...>::values, sizeof...(Ts))
+    >
+{};
+
+
+// formatted characters are written as themselves, followed by a space
+template<class T>
+struct serialized_size_bound<T, typename std::enable_if<
+  std::is_same<T,char>::value || std::is_same<T,signed char>::value || std::is_same<T,unsigned char>::value
+>::type> : size_bound<true, 2> {};
+
+// other integers are written as a sign, their digits, and a space
+template<class T>
+struct serialized_size_bound<T, typename std::enable_if<
+  std::is_integral<T>::value && !std::is_same<T,char>::value && !std::is_same<T,signed char>::value && !std::is_same<T,unsigned char>::value
+>::type> : size_bound<true, std::numeric_limits<T>::digits10 + 3> {};
+
+// floating point numbers are written as a sign, their significant digits, a decimal point, an exponent of up to four digits, and a space
+template<class T>
+struct serialized_size_bound<T, typename std::enable_if<
+  std::is_floating_point<T>::value
+>::type> : size_bound<true, std::numeric_limits<T>::max_digits10 + 9> {};
+
+// void pointers and function pointers are written in hexadecimal, followed by a space
+template<class T>
+struct serialized_size_bound<T, typename std::enable_if<
+  std::is_same<T,void*>::value || (std::is_pointer<T>::value && std::is_function<typename std::remove_pointer<T>::type>::value)
+>::type> : size_bound<true, 2 * sizeof(void*) + 3> {};
+
+// member function pointers are length-prefixed runs of bytes
+template<class T>
+struct serialized_size_bound<T, typename std::enable_if<
+  std::is_member_function_pointer<T>::value
+>::type> : size_bound<true, decimal_digits(sizeof(T)) + 1 + sizeof(T)> {};
+
+template<class... Ts>
+struct serialized_size_bound<std::tuple<Ts...>> : serialized_size_bound_all<Ts...> {};
+
+template<class T1, class T2>
+struct serialized_size_bound<std::pair<T1,T2>> : serialized_size_bound_all<T1,T2> {};
+
+template<class T, std::size_t N>
+struct serialized_contiguous_range_size_bound
+  : size_bound<
+      is_bitwise_serializable<T>::value || serialized_size_bound<T>::is_bounded,
+      decimal_digits(N) + 1 + N * (is_bitwise_serializable<T>::value ? sizeof(T) : serialized_size_bound<T>::value)
+    >
+{};
+
+template<class T, std::size_t N>
+struct serialized_size_bound<std::array<T,N>> : serialized_contiguous_range_size_bound<T,N> {};
+
+template<class T, std::size_t N>
+struct serialized_size_bound<T[N]> : serialized_contiguous_range_size_bound<T,N> {};
+
+
+// type_fingerprint<T>::value is a hash of the structure of T's serialization, computed at compile time
+// two types which serialize differently (e.g. int vs. long, float vs. double, or tuples with different elements)
+// have different fingerprints, so a receiver can tell whether a message was serialized for the types it expects
+// types with user-defined serialize() contribute only their size and alignment
+// specialize type_fingerprint for user-defined types whose layout matters on the wire
+
+enum class type_fingerprint_kind : std::uint64_t
+{
+  opaque = 1,
+  void_type,
+  boolean,
+  character,
+  integer,
+  floating_point,
+  enumeration,
+  pointer,
+  function_pointer,
+  member_function_pointer,
+  tuple,
+  pair,
+  array,
+  string,
+  vector,
+  map,
+  optional,
+  closure
+};
+
+
+constexpr std::uint64_t fingerprint_combine(std::uint64_t seed, std::uint64_t value)
+{
+  return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+constexpr std::uint64_t fingerprint_combine(type_fingerprint_kind kind, std::uint64_t value)
+{
+  return fingerprint_combine(static_cast<std::uint64_t>(kind), value);
 }
 
+template<type_fingerprint_kind kind, std::uint64_t value>
+struct fingerprint_constant : std::integral_constant<std::uint64_t, fingerprint_combine(kind, value)> {};
+
+
+template<class T, class Enable = void>
+struct type_fingerprint
+  : fingerprint_constant<type_fingerprint_kind::opaque, fingerprint_combine(sizeof(T), alignof(T))>
+{};
+
+
+// combines fingerprints[0, n) from the right, so that the combination of a single fingerprint x is fingerprint_combine(x, 0)
+constexpr std::uint64_t fingerprint_combine_all(const std::uint64_t* fingerprints, std::size_t n)
+{
+  return n == 0 ? 0 : fingerprint_combine(fingerprints[0], fingerprint_combine_all(fingerprints + 1, n - 1));
+}
+
+template<class... Ts>
+struct type_fingerprint_all
+  : std::integral_constant<std::uint64_t, fingerprint_combine_all(constant_array<std::uint64_t, type_fingerprint<Ts>::value...>::values, sizeof...(Ts))>
+{};
+
+
+template<>
+struct type_fingerprint<void> : fingerprint_constant<type_fingerprint_kind::void_type, 0> {};
+
+template<>
+struct type_fingerprint<bool> : fingerprint_constant<type_fingerprint_kind::boolean, sizeof(bool)> {};
+
+template<class T>
+struct type_fingerprint<T, typename std::enable_if<
+  std::is_same<T,char>::value || std::is_same<T,signed char>::value || std::is_same<T,unsigned char>::value
+>::type> : fingerprint_constant<type_fingerprint_kind::character, std::is_signed<T>::value> {};
+
+template<class T>
+struct type_fingerprint<T, typename std::enable_if<
+  std::is_integral<T>::value && !std::is_same<T,bool>::value &&
+  !std::is_same<T,char>::value && !std::is_same<T,signed char>::value && !std::is_same<T,unsigned char>::value
+>::type> : fingerprint_constant<type_fingerprint_kind::integer, fingerprint_combine(sizeof(T), std::is_signed<T>::value)> {};
+
+template<class T>
+struct type_fingerprint<T, typename std::enable_if<
+  std::is_floating_point<T>::value
+>::type> : fingerprint_constant<type_fingerprint_kind::floating_point, fingerprint_combine(sizeof(T), std::numeric_limits<T>::digits)> {};
+
+template<class T>
+struct type_fingerprint<T, typename std::enable_if<
+  std::is_enum<T>::value
+>::type> : fingerprint_constant<type_fingerprint_kind::enumeration, type_fingerprint<typename std::underlying_type<T>::type>::value> {};
+
+// pointers travel as addresses, so the type they point to doesn't affect their serialization
+template<class T>
+struct type_fingerprint<T*, typename std::enable_if<
+  !std::is_function<T>::value
+>::type> : fingerprint_constant<type_fingerprint_kind::pointer, sizeof(T*)> {};
+
+template<class Result, class... Args>
+struct type_fingerprint<Result (*)(Args...)>
+  : fingerprint_constant<type_fingerprint_kind::function_pointer, fingerprint_combine(type_fingerprint<Result>::value, type_fingerprint_all<Args...>::value)>
+{};
+
+template<class Result, class Class, class... Args>
+struct type_fingerprint<Result (Class::*)(Args...)>
+  : fingerprint_constant<type_fingerprint_kind::member_function_pointer, fingerprint_combine(type_fingerprint<Result>::value, type_fingerprint_all<Args...>::value)>
+{};
+
+template<class Result, class Class, class... Args>
+struct type_fingerprint<Result (Class::*)(Args...) const>
+  : fingerprint_constant<type_fingerprint_kind::member_function_pointer, fingerprint_combine(~type_fingerprint<Result>::value, type_fingerprint_all<Args...>::value)>
+{};
+
+template<class... Ts>
+struct type_fingerprint<std::tuple<Ts...>>
+  : fingerprint_constant<type_fingerprint_kind::tuple, fingerprint_combine(sizeof...(Ts), type_fingerprint_all<Ts...>::value)>
+{};
+
+template<class T1, class T2>
+struct type_fingerprint<std::pair<T1,T2>> : fingerprint_constant<type_fingerprint_kind::pair, type_fingerprint_all<T1,T2>::value> {};
+
+template<class T, std::size_t N>
+struct type_fingerprint<std::array<T,N>> : fingerprint_constant<type_fingerprint_kind::array, fingerprint_combine(N, type_fingerprint<T>::value)> {};
+
+template<class T, std::size_t N>
+struct type_fingerprint<T[N]> : type_fingerprint<std::array<T,N>> {};
+
+template<>
+struct type_fingerprint<std::string> : fingerprint_constant<type_fingerprint_kind::string, 0> {};
+
+template<class T, class Alloc>
+struct type_fingerprint<std::vector<T,Alloc>> : fingerprint_constant<type_fingerprint_kind::vector, type_fingerprint<T>::value> {};
+
+// maps and unordered maps serialize identically
+template<class Key, class T, class Compare, class Alloc>
+struct type_fingerprint<std::map<Key,T,Compare,Alloc>> : fingerprint_constant<type_fingerprint_kind::map, type_fingerprint_all<Key,T>::value> {};
+
+template<class Key, class T, class Hash, class KeyEqual, class Alloc>
+struct type_fingerprint<std::unordered_map<Key,T,Hash,KeyEqual,Alloc>> : fingerprint_constant<type_fingerprint_kind::map, type_fingerprint_all<Key,T>::value> {};
+
+#if __cplusplus >= 201703L
+template<class T>
+struct type_fingerprint<std::optional<T>> : fingerprint_constant<type_fingerprint_kind::optional, type_fingerprint<T>::value> {};
+#endif
+
+
 class output_archive
 {
   private:
-    // this is the terminal case of operator() above
-    // it never needs to be called by a client
-    inline void operator()() {}
-
     std::ostream& stream_;
 
   public:
@@ -165,12 +865,14 @@ class output_archive
       stream_.flush();
     }
 
-    template<class Arg, class... Args>
-    void operator()(const Arg& arg, const Args&... args)
+    // serializes args in order
+    // the braced initializer guarantees left-to-right evaluation without recursing once per argument
+    // once the stream fails, e.g. because a fixed-size buffer is full, the remaining args aren't traversed
+    template<class... Args>
+    void operator()(const Args&... args)
     {
-      serialize(*this, arg);
-
-      (*this)(args...);
+      int unused[] = {0, (stream_ ? (serialize(*this, args), 0) : 0)...};
+      (void)unused;
     }
 
     inline std::ostream& stream()
@@ -186,12 +888,12 @@ class input_archive
       : stream_(is)
     {}
 
-    template<class Arg, class... Args>
-    void operator()(Arg& arg, Args&... args)
+    // deserializes args in order
+    template<class... Args>
+    void operator()(Args&... args)
     {
-      deserialize(*this, arg);
-
-      (*this)(args...);
+      int unused[] = {0, (deserialize(*this, args), 0)...};
+      (void)unused;
     }
 
     inline std::istream& stream()
@@ -200,14 +902,63 @@ class input_archive
     }
 
   private:
-    // this is the terminal case of operator() above
-    // it never needs to be called by a client
-    inline void operator()() {}
-
     std::istream& stream_;
 };
 
 
+// a receiver reads the type_fingerprint its sender wrote ahead of a serialization, and checks it against the one it expects
+// mismatch describes the likely cause of a mismatch
+// when ACTIVE_MESSAGE_DISABLE_TYPE_FINGERPRINTS is defined, senders write no fingerprint, so these read and check nothing
+
+inline std::uint64_t read_type_fingerprint(input_archive& archive)
+{
+  std::uint64_t result = 0;
+#ifndef ACTIVE_MESSAGE_DISABLE_TYPE_FINGERPRINTS
+  archive(result);
+#else
+  (void)archive;
+#endif
+  return result;
+}
+
+inline void check_type_fingerprint(std::uint64_t sent, std::uint64_t expected, const char* mismatch)
+{
+#ifndef ACTIVE_MESSAGE_DISABLE_TYPE_FINGERPRINTS
+  if(sent != expected)
+  {
+    throw std::runtime_error(mismatch);
+  }
+#else
+  (void)sent;
+  (void)expected;
+  (void)mismatch;
+#endif
+}
+
+
+// serializes args into buffer, in its inline storage when the serialization fits
+// the serialization is written in a single pass: if it overflows the inline storage, it continues on the heap
+template<std::size_t N, class Allocator, class... Args>
+void serialize_to_buffer(small_buffer<N,Allocator>& buffer, const Args&... args)
+{
+  small_buffer_output_stream<N,Allocator> os(buffer);
+
+  {
+    output_archive archive(os);
+    archive(args...);
+  }
+
+  os.commit();
+}
+
+
+// define ACTIVE_MESSAGE_ANY_INLINE_CAPACITY to change the size of the serializations
+// any stores without allocating
+// the default leaves room for a reply active_message whose closure fits inline
+#ifndef ACTIVE_MESSAGE_ANY_INLINE_CAPACITY
+#define ACTIVE_MESSAGE_ANY_INLINE_CAPACITY 256
+#endif
+
 class any
 {
   public:
@@ -216,15 +967,7 @@ class any
     template<class T>
     any(T&& value)
     {
-      std::stringstream os;
-
-      {
-        output_archive archive(os);
-
-        archive(value);
-      }
-
-      representation_ = os.str();
+      serialize_to_buffer(representation_, value);
     }
 
     template<class ValueType>
@@ -232,7 +975,7 @@ class any
     {
       ValueType result;
 
-      std::stringstream is(self.representation_);
+      string_view_stream is(self.representation_.data(), self.representation_.size());
       input_archive archive(is);
 
       archive(result);
@@ -240,17 +983,18 @@ class any
       return result;
     }
 
+    // an any serializes exactly like the value it contains
+    template<class OutputArchive>
+    friend void serialize(OutputArchive& ar, const any& self)
+    {
+      ar.stream().write(self.representation_.data(), self.representation_.size());
+    }
+
   private:
-    std::string representation_;
+    small_buffer<ACTIVE_MESSAGE_ANY_INLINE_CAPACITY> representation_;
 };
 
 
-template<class OutputArchive>
-void serialize(OutputArchive& ar, const any& a)
-{
-  ar.stream() << a;
-}
-
 template<class InputArchive>
 void deserialize(InputArchive& ar, any& a)
 {
@@ -258,21 +1002,6 @@ void deserialize(InputArchive& ar, any& a)
 }
 
 
-template<class... Conditions>
-struct conjunction;
-
-template<>
-struct conjunction<> : std::true_type {};
-
-template<class Condition, class... Conditions>
-struct conjunction<Condition, Conditions...>
-  : std::integral_constant<
-      bool,
-      Condition::value && conjunction<Conditions...>::value
-    >
-{};
-
-
 template<class T>
 struct can_serialize_impl
 {
@@ -317,111 +1046,421 @@ using can_deserialize_all = conjunction<can_deserialize<Ts>...>;
 
 
 
+// define ACTIVE_MESSAGE_CLOSURE_INLINE_CAPACITY to change the size of the serializations
+// serializable_closure stores without allocating
+#ifndef ACTIVE_MESSAGE_CLOSURE_INLINE_CAPACITY
+#define ACTIVE_MESSAGE_CLOSURE_INLINE_CAPACITY 192
+#endif
+
+
+// ACTIVE_MESSAGE_INIT_PRIORITY_FIRST makes a global be constructed before the globals of any translation unit
+// which don't ask for a priority, however the program is linked
+// define it for compilers other than GCC and Clang
+#ifndef ACTIVE_MESSAGE_INIT_PRIORITY_FIRST
+#  if defined(__GNUC__)
+#    define ACTIVE_MESSAGE_INIT_PRIORITY_FIRST __attribute__((init_priority(101)))
+#  else
+#    error "serialization.hpp: Define ACTIVE_MESSAGE_INIT_PRIORITY_FIRST so that invokers register before system_context_ is constructed."
+#  endif
+#endif
+
+// by default, a serializable_closure begins with the type_fingerprint of its function and arguments, followed by its invoker,
+// and the receiver checks both before calling the invoker
+// define ACTIVE_MESSAGE_DISABLE_TYPE_FINGERPRINTS to omit the fingerprint
+// every node must be built with the same setting
+
+
+// closure_view refers to a function and its arguments, and deserializes exactly like a serializable_closure containing them
+// it lets a message be serialized straight from its sender's arguments, without first copying them into a closure
+// like a std::string_view, a closure_view must not outlive what it refers to
+// use serializable_closure::view() to create one
+template<class... Values>
+class closure_view
+{
+  private:
+    // arrays and functions are held as the pointers they decay to, just as a closure's arguments are,
+    // and other scalars, such as function pointers, are held by value, so a view may refer to temporary ones
+    template<class T>
+    using reference = typename std::conditional<
+      std::is_array<T>::value || std::is_function<T>::value || std::is_scalar<T>::value,
+      typename std::decay<const T>::type,
+      const T&
+    >::type;
+
+  public:
+    using invoker_type = any (*)(input_archive&);
+
+    inline closure_view(invoker_type invoker, std::uint64_t fingerprint, const Values&... values)
+      : invoker_(invoker),
+        fingerprint_(fingerprint),
+        values_(values...)
+    {}
+
+    // like a closure, a closure_view is serialized like a std::string, whose length precedes it
+    // rather than measuring the body before writing it, room is left for the length, which is filled in afterward,
+    // so the body is traversed once
+    template<class OutputArchive>
+    friend void serialize(OutputArchive& ar, const closure_view& self)
+    {
+      std::ostream& os = ar.stream();
+
+      // nothing more can be written to a stream which has failed
+      if(!os)
+      {
+        return;
+      }
+
+      std::ostream::pos_type length_position = os.tellp();
+
+      if(length_position == std::ostream::pos_type(-1))
+      {
+        // a stream which can't seek back gets the body measured first
+        self.serialize_measured(ar);
+        return;
+      }
+
+      char length[length_width + 1];
+      std::memset(length, ' ', sizeof(length));
+      os.write(length, sizeof(length));
+
+      std::ostream::pos_type body_position = os.tellp();
+      self.serialize_body(ar, make_index_sequence<sizeof...(Values)>());
+      std::ostream::pos_type end_position = os.tellp();
+
+      if(!os)
+      {
+        return;
+      }
+
+      std::size_t size = static_cast<std::size_t>(end_position - body_position);
+
+      if(decimal_digits(size) > length_width)
+      {
+        // the length doesn't fit in the room left for it, so write the body again, measured first
+        os.seekp(length_position);
+        self.serialize_measured(ar);
+        return;
+      }
+
+      // the length is right-aligned, and deserialize_length() skips the spaces before it
+      std::size_t i = length_width;
+      do
+      {
+        length[--i] = static_cast<char>('0' + size % 10);
+        size /= 10;
+      }
+      while(size > 0);
+
+      os.seekp(length_position);
+      os.write(length, sizeof(length));
+      os.seekp(end_position);
+    }
+
+  private:
+    // the room left for the length is as wide as the largest length the body may have,
+    // or, when that isn't known, wide enough for any body smaller than 10 GB
+#ifndef ACTIVE_MESSAGE_DISABLE_TYPE_FINGERPRINTS
+    using body_size_bound = serialized_size_bound_all<std::uint64_t, invoker_type, typename std::decay<Values>::type...>;
+#else
+    using body_size_bound = serialized_size_bound_all<invoker_type, typename std::decay<Values>::type...>;
+#endif
+
+    static constexpr std::size_t length_width = body_size_bound::is_bounded ? decimal_digits(body_size_bound::value) : 10;
+
+    template<class OutputArchive>
+    void serialize_measured(OutputArchive& ar) const
+    {
+      counting_output_stream counter;
+
+      {
+        output_archive counting_archive(counter);
+        serialize_body(counting_archive, make_index_sequence<sizeof...(Values)>());
+      }
+
+      serialize_length(ar, counter.size());
+      serialize_body(ar, make_index_sequence<sizeof...(Values)>());
+    }
+
+    template<class OutputArchive, size_t... Indices>
+    void serialize_body(OutputArchive& ar, index_sequence<Indices...>) const
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_TYPE_FINGERPRINTS
+      ar(fingerprint_, invoker_, std::get<Indices>(values_)...);
+#else
+      ar(invoker_, std::get<Indices>(values_)...);
+#endif
+    }
+
+    invoker_type invoker_;
+    std::uint64_t fingerprint_;
+    std::tuple<reference<Values>...> values_;
+};
+
+// the type of closure_view which refers to values of the given types
+template<class... Ts>
+using closure_view_of = closure_view<typename std::remove_cv<typename std::remove_reference<Ts>::type>::type...>;
+
+
 class serializable_closure
 {
   private:
     static void noop_function() {}
 
   public:
+    using invoker_type = any (*)(input_archive&);
+
     serializable_closure()
       : serializable_closure(&noop_function)
     {}
 
+    // func and args... are serialized where they are rather than copied
+    // like arguments passed by value, arrays and functions are serialized as the pointers they decay to
     template<class Function, class... Args,
-             __REQUIRES(can_serialize_all<Function,Args...>::value),
-             __REQUIRES(can_deserialize_all<Function,Args...>::value),
-             __REQUIRES(is_invocable<Function,Args...>::value)
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
             >
-    explicit serializable_closure(Function func, Args... args)
-      : serialized_(serialize_function_and_arguments(&deserialize_and_invoke<Function,Args...>, func, args...))
-    {}
+    explicit serializable_closure(Function&& func, Args&&... args)
+    {
+      using function_type = typename std::decay<Function>::type;
+
+#ifndef ACTIVE_MESSAGE_DISABLE_TYPE_FINGERPRINTS
+      serialize_to_buffer(serialized_,
+        fingerprint<function_type,typename std::decay<Args>::type...>::value,
+        invoker_address<function_type,typename std::decay<Args>::type...>(),
+        static_cast<const function_type&>(func),
+        static_cast<const typename std::decay<Args>::type&>(args)...
+      );
+#else
+      serialize_to_buffer(serialized_,
+        invoker_address<function_type,typename std::decay<Args>::type...>(),
+        static_cast<const function_type&>(func),
+        static_cast<const typename std::decay<Args>::type&>(args)...
+      );
+#endif
+    }
+
+    // returns a closure_view which serializes like serializable_closure(func, args...)
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    static closure_view_of<Function,Args...> view(Function&& func, Args&&... args)
+    {
+      using function_type = typename std::decay<Function>::type;
+
+      return closure_view_of<Function,Args...>(
+        invoker_address<function_type,typename std::decay<Args>::type...>(),
+        fingerprint<function_type,typename std::decay<Args>::type...>::value,
+        func, args...
+      );
+    }
+
+    // returns a closure_view of a closure of Function and Args..., which serializes values... in their place
+    // the values must serialize exactly like the arguments they stand for,
+    // e.g. the elements of a std::tuple may stand for the tuple
+    template<class Function, class... Args, class... Values>
+    static closure_view<Values...> view_as(const Values&... values)
+    {
+      return closure_view<Values...>(invoker_address<Function,Args...>(), fingerprint<Function,Args...>::value, values...);
+    }
 
     any operator()() const
     {
-      std::stringstream is(serialized_);
+      string_view_stream is(serialized_.data(), serialized_.size());
       input_archive archive(is);
 
-      // extract a function_ptr_type from the beginning of the buffer
-      using function_ptr_type = any (*)(input_archive&);
-      function_ptr_type invoke_me = nullptr;
-      archive(invoke_me);
+      return invoke(archive);
+    }
 
-      // invoke the function pointer on the remaining data
-      return invoke_me(archive);
+    // invokes the closure whose serialization is at data, without first deserializing it into a serializable_closure
+    static any invoke_serialization(const char* data, std::size_t size)
+    {
+      string_view_stream is(data, size);
+      input_archive archive(is);
+
+      // skip over the length which precedes the closure
+      deserialize_length(archive);
+
+      return invoke(archive);
     }
 
+    // calls f(data, size) on each closure serialization in a run of them written back to back,
+    // e.g. to invoke each with invoke_serialization()
+    template<class Function>
+    static void for_each_serialization(const char* data, std::size_t size, Function f)
+    {
+      const char* end = data + size;
+
+      while(data < end)
+      {
+        // each serialization begins with its length, which is followed by a single space
+        char* body = nullptr;
+        std::size_t length = std::strtoull(data, &body, 10);
+        body += 1;
+
+        std::size_t serialization_size = (body - data) + length;
+        f(data, serialization_size);
+
+        data += serialization_size;
+      }
+    }
+
+    // a closure is serialized like a std::string
     template<class OutputArchive>
     friend void serialize(OutputArchive& ar, const serializable_closure& sc)
     {
-      ar(sc.serialized_);
+      serialize_length(ar, sc.serialized_.size());
+      ar.stream().write(sc.serialized_.data(), sc.serialized_.size());
     }
 
     template<class InputArchive>
     friend void deserialize(InputArchive& ar, serializable_closure& sc)
     {
-      ar(sc.serialized_);
+      std::size_t length = deserialize_length(ar);
+      ar.stream().read(sc.serialized_.resize(length), length);
     }
 
   private:
-    template<class Function, class Tuple,
-             class ApplyResult = decltype(apply(std::declval<Function&&>(), std::declval<Tuple&&>())),
-             __REQUIRES(std::is_void<ApplyResult>::value)
-            >
-    static any apply_and_return_any(Function&& f, Tuple&& t)
+    inline static any invoke(input_archive& archive)
     {
-      apply(std::forward<Function>(f), std::forward<Tuple>(t));
-      return any();
+      // extract the fingerprint and the invoker from the beginning of the buffer
+      std::uint64_t sent_fingerprint = read_type_fingerprint(archive);
+
+      invoker_type invoke_me = nullptr;
+      archive(invoke_me);
+
+      // the invoker came off the wire, so check it before calling through it
+      check_invoker(invoke_me, sent_fingerprint);
+
+      // invoke the function pointer on the remaining data
+      return invoke_me(archive);
     }
 
-    template<class Function, class Tuple,
-             class ApplyResult = decltype(apply(std::declval<Function&&>(), std::declval<Tuple&&>())),
-             __REQUIRES(!std::is_void<ApplyResult>::value)
-            >
-    static any apply_and_return_any(Function&& f, Tuple&& t)
+    template<class FunctionPtr, class... Args>
+    using fingerprint = type_fingerprint_all<FunctionPtr,Args...>;
+
+    // maps each invoker this program can send to the fingerprint of the types it deserializes
+    inline static std::unordered_map<invoker_type, std::uint64_t>& registered_invokers()
     {
-      return apply(std::forward<Function>(f), std::forward<Tuple>(t));
+      static std::unordered_map<invoker_type, std::uint64_t> result;
+      return result;
     }
 
-    template<class FunctionPtr, class... Args>
-    static any deserialize_and_invoke(input_archive& archive)
+    // registers an invoker when it is constructed
+    struct invoker_registrar
+    {
+      inline invoker_registrar(invoker_type invoker, std::uint64_t fingerprint)
+      {
+        registered_invokers()[invoker] = fingerprint;
+      }
+    };
+
+    inline static void check_invoker(invoker_type invoker, std::uint64_t sent_fingerprint)
     {
-      // deserialize function pointer and its arguments
-      std::tuple<FunctionPtr,Args...> function_and_args;
-      archive(function_and_args);
+      auto found = registered_invokers().find(invoker);
 
-      // split tuple into a function pointer and arguments
-      FunctionPtr f = std::get<0>(function_and_args);
-      std::tuple<Args...> arguments = tail(function_and_args);
+      if(found == registered_invokers().end())
+      {
+        throw std::runtime_error("serializable_closure: Unknown invoker. Were the sender and receiver built from the same source?");
+      }
 
-      return apply_and_return_any(f, arguments);
+      // check that the sender serialized the types the invoker is about to deserialize
+      check_type_fingerprint(sent_fingerprint, found->second,
+        "serializable_closure: Type fingerprint mismatch. Were the sender and receiver built from the same source?"
+      );
     }
 
-    template<class... Args>
-    static std::string serialize_function_and_arguments(const Args&... args)
+    // every invoker a program can send is registered during static initialization,
+    // and every node runs the same program, so a receiver knows every invoker a sender may name
+    // the registrations are constructed before any global without an init_priority, such as system_context_,
+    // so every invoker is registered before a handler can run, and before any thread which could read the registry starts
+    template<class FunctionPtr, class... Args>
+    struct invoker_registration
     {
-      std::stringstream os;
+      static const invoker_registrar registered;
+    };
 
+    // returns the invoker of a closure of FunctionPtr and Args...
+    // naming its registration here instantiates it, so every invoker a closure is created with is registered
+    template<class FunctionPtr, class... Args>
+    static invoker_type invoker_address()
+    {
+      static_cast<void>(&invoker_registration<FunctionPtr,Args...>::registered);
+      return &invoker<FunctionPtr,Args...>::deserialize_and_invoke;
+    }
+
+    // invoker_impl's deserialize_and_invoke reads a closure's function pointer and arguments and invokes it
+    // it is a single function whose arguments are expanded from Indices, rather than a chain of helpers,
+    // and it is specialized on whether the result is void so that it needn't dispatch on it
+    template<class FunctionPtr, class Arguments, class Indices, bool ReturnsVoid>
+    struct invoker_impl;
+
+    template<class FunctionPtr, class... Args>
+    using invoker = invoker_impl<
+      FunctionPtr,
+      std::tuple<Args...>,
+      make_index_sequence<sizeof...(Args)>,
+      std::is_void<invoke_result_t<FunctionPtr,Args...>>::value
+    >;
+
+    template<class FunctionPtr, class... Args, size_t... Indices>
+    struct invoker_impl<FunctionPtr, std::tuple<Args...>, index_sequence<Indices...>, false>
+    {
+      static any deserialize_and_invoke(input_archive& archive)
       {
-        output_archive archive(os);
+        // deserialize function pointer and its arguments
+        FunctionPtr f{};
+        std::tuple<Args...> arguments;
+        archive(f, std::get<Indices>(arguments)...);
 
-        // serialize arguments into the archive
-        archive(args...);
+        // the arguments are used only once, so move them into f's parameters
+        return f(std::move(std::get<Indices>(arguments))...);
       }
+    };
 
-      return os.str();
-    }
+    template<class FunctionPtr, class... Args, size_t... Indices>
+    struct invoker_impl<FunctionPtr, std::tuple<Args...>, index_sequence<Indices...>, true>
+    {
+      static any deserialize_and_invoke(input_archive& archive)
+      {
+        FunctionPtr f{};
+        std::tuple<Args...> arguments;
+        archive(f, std::get<Indices>(arguments)...);
 
-    std::string serialized_;
+        f(std::move(std::get<Indices>(arguments))...);
+        return any();
+      }
+    };
+
+    small_buffer<ACTIVE_MESSAGE_CLOSURE_INLINE_CAPACITY> serialized_;
 };
 
 
+template<class FunctionPtr, class... Args>
+const serializable_closure::invoker_registrar serializable_closure::invoker_registration<FunctionPtr,Args...>::registered ACTIVE_MESSAGE_INIT_PRIORITY_FIRST (
+  &invoker<FunctionPtr,Args...>::deserialize_and_invoke, fingerprint<FunctionPtr,Args...>::value
+);
+
+
+// a closure's own fingerprint is checked when it is invoked, so its size on the wire is all that matters here
+template<>
+struct type_fingerprint<serializable_closure> : fingerprint_constant<type_fingerprint_kind::closure, 0> {};
+
+
 template<class T>
 std::string to_string(const T& value)
 {
-  std::stringstream os;
-  output_archive ar(os);
-  ar(value);
-  return os.str();
+  std::string result;
+
+  {
+    string_output_stream os(result);
+    output_archive ar(os);
+    ar(value);
+  }
+
+  return result;
 }
 
 
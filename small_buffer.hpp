@@ -0,0 +1,132 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <array>
+#include <string>
+#include <memory>
+#include <utility>
+
+
+// small_buffer<N> holds a run of bytes in inline storage when it fits in N bytes, and otherwise in storage from its allocator
+template<std::size_t N, class Allocator = std::allocator<char>>
+class small_buffer
+{
+  public:
+    static const std::size_t inline_capacity = N;
+
+    using allocator_type = Allocator;
+    using string_type = std::basic_string<char, std::char_traits<char>, Allocator>;
+
+    inline small_buffer()
+      : size_(0)
+    {}
+
+    inline explicit small_buffer(const Allocator& alloc)
+      : size_(0),
+        heap_(alloc)
+    {}
+
+    inline allocator_type get_allocator() const
+    {
+      return heap_.get_allocator();
+    }
+
+    inline const char* data() const
+    {
+      return is_inline() ? inline_.data() : heap_.data();
+    }
+
+    inline char* data()
+    {
+      return is_inline() ? inline_.data() : &heap_[0];
+    }
+
+    inline std::size_t size() const
+    {
+      return size_;
+    }
+
+    inline bool is_inline() const
+    {
+      return size_ <= N;
+    }
+
+    // discards the contents and returns storage for size bytes
+    inline char* resize(std::size_t size)
+    {
+      size_ = size;
+
+      if(is_inline())
+      {
+        heap_.clear();
+        return inline_.data();
+      }
+
+      heap_.resize(size);
+      return &heap_[0];
+    }
+
+    inline void assign(const char* data, std::size_t size)
+    {
+      std::memcpy(resize(size), data, size);
+    }
+
+    inline void assign(string_type&& data)
+    {
+      if(data.size() <= N)
+      {
+        assign(data.data(), data.size());
+      }
+      else
+      {
+        heap_ = std::move(data);
+        size_ = heap_.size();
+      }
+    }
+
+    // the inline storage, for writers which fill it directly
+    // follow with set_inline_size()
+    inline char* inline_data()
+    {
+      return inline_.data();
+    }
+
+    inline void set_inline_size(std::size_t size)
+    {
+      heap_.clear();
+      size_ = size;
+    }
+
+  private:
+    std::size_t size_;
+    std::array<char, N> inline_;
+    string_type heap_;
+};
+
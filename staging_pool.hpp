@@ -0,0 +1,225 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <shmem.h>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+
+
+// staging_pool manages a region of the symmetric heap in which a node stages large messages
+// the node which receives a staged message fetches it with shmem_getmem and then releases its block
+// by writing to the block's header on the owning node, so no reply is needed to recycle blocks
+// symmetric objects needn't have the same address on every node, so blocks are named by their offset
+// from the pool's base, which every node translates with its own pool
+class staging_pool
+{
+  public:
+    // constructing a staging_pool is a collective operation:
+    // every node must construct its staging_pools in the same order with the same capacity
+    inline explicit staging_pool(std::size_t capacity)
+      : base_(nullptr),
+        capacity_(round_up(capacity))
+    {
+      if(capacity_ > 0)
+      {
+        base_ = static_cast<char*>(shmem_malloc(capacity_));
+        free_blocks_.emplace(0, capacity_);
+      }
+    }
+
+    // XXX note that we don't call shmem_free() because shmem may already have been shutdown
+
+    inline std::size_t capacity() const
+    {
+      return capacity_;
+    }
+
+    // returns a pointer to num_bytes of symmetric memory, or nullptr if they are not currently available
+    inline char* try_allocate(std::size_t num_bytes)
+    {
+      std::size_t block_size = round_up(header_size + num_bytes);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      char* result = allocate_block(block_size);
+      if(!result)
+      {
+        // recycle the blocks which have been released since the last time we looked and try again
+        reclaim_released_blocks();
+        result = allocate_block(block_size);
+      }
+
+      return result;
+    }
+
+    // returns a pointer to num_bytes of symmetric memory, waiting for other nodes to release blocks if necessary
+    // returns nullptr if num_bytes could never be allocated
+    inline char* allocate(std::size_t num_bytes)
+    {
+      if(round_up(header_size + num_bytes) > capacity_)
+      {
+        return nullptr;
+      }
+
+      char* result = nullptr;
+      while(!(result = try_allocate(num_bytes)))
+      {
+        std::this_thread::yield();
+      }
+
+      return result;
+    }
+
+    // returns the offset of data, which was returned by allocate(), from the pool's base
+    inline std::size_t offset_of(const char* data) const
+    {
+      return data - base_;
+    }
+
+    // returns this node's address of the data at offset in every node's pool
+    // the address is only dereferenced directly when the data was allocated by this node;
+    // otherwise, it names the symmetric data of the owner for shmem_getmem
+    inline char* address_of(std::size_t offset) const
+    {
+      return base_ + offset;
+    }
+
+    // returns the block at offset, which was allocated on the owner node, to its owner
+    // a block may only be released once
+    inline void release(std::size_t offset, int owner)
+    {
+      block_header* header = reinterpret_cast<block_header*>(address_of(offset) - header_size);
+      shmem_long_p(&header->released, 1, owner);
+    }
+
+  private:
+    struct block_header
+    {
+      // set to 1 by the node which reads the block
+      long released;
+
+      std::size_t size;
+    };
+
+    // blocks are aligned to a cache line
+    static const std::size_t alignment = 64;
+    static const std::size_t header_size = alignment;
+
+    static_assert(sizeof(block_header) <= header_size, "block_header is too large.");
+
+    inline static std::size_t round_up(std::size_t n)
+    {
+      return (n + alignment - 1) / alignment * alignment;
+    }
+
+    // first fit
+    inline char* allocate_block(std::size_t block_size)
+    {
+      for(auto free_block = free_blocks_.begin(); free_block != free_blocks_.end(); ++free_block)
+      {
+        if(free_block->second >= block_size)
+        {
+          std::size_t offset = free_block->first;
+          std::size_t remainder = free_block->second - block_size;
+
+          free_blocks_.erase(free_block);
+          if(remainder > 0)
+          {
+            free_blocks_.emplace(offset + block_size, remainder);
+          }
+
+          block_header* header = reinterpret_cast<block_header*>(base_ + offset);
+          header->released = 0;
+          header->size = block_size;
+
+          allocated_blocks_.push_back(offset);
+
+          return base_ + offset + header_size;
+        }
+      }
+
+      return nullptr;
+    }
+
+    inline void reclaim_released_blocks()
+    {
+      auto first_unreleased = std::partition(allocated_blocks_.begin(), allocated_blocks_.end(), [this](std::size_t offset)
+      {
+        // the released flag is written by another node, so read it through a volatile
+        const volatile long* released = &reinterpret_cast<block_header*>(base_ + offset)->released;
+        return *released == 0;
+      });
+
+      for(auto block = first_unreleased; block != allocated_blocks_.end(); ++block)
+      {
+        deallocate_block(*block, reinterpret_cast<block_header*>(base_ + *block)->size);
+      }
+
+      allocated_blocks_.erase(first_unreleased, allocated_blocks_.end());
+    }
+
+    // returns a block to the free list, coalescing it with its neighbors
+    inline void deallocate_block(std::size_t offset, std::size_t size)
+    {
+      auto next = free_blocks_.lower_bound(offset);
+
+      if(next != free_blocks_.end() && offset + size == next->first)
+      {
+        size += next->second;
+        next = free_blocks_.erase(next);
+      }
+
+      if(next != free_blocks_.begin())
+      {
+        auto previous = std::prev(next);
+        if(previous->first + previous->second == offset)
+        {
+          previous->second += size;
+          return;
+        }
+      }
+
+      free_blocks_.emplace_hint(next, offset, size);
+    }
+
+    std::mutex mutex_;
+    char* base_;
+    std::size_t capacity_;
+
+    // maps the offset of each free block to its size
+    std::map<std::size_t, std::size_t> free_blocks_;
+
+    // the offsets of blocks which have been allocated but not yet reclaimed
+    std::vector<std::size_t> allocated_blocks_;
+};
@@ -0,0 +1,88 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// $ ./openshmem-am-root/bin/oshc++ -std=c++11 startup.cpp 
+// $ ./openshmem-am-root/bin/oshrun ./a.out -n 2
+// PE 0: Greeted by PE 1 during startup
+// PE 1: Greeted by PE 0 during startup
+// PE 0: PE 1 echoed 7
+// PE 1: PE 0 echoed 8
+
+#include <iostream>
+#include <future>
+#include <atomic>
+#include <cassert>
+
+#include "execution_context.hpp"
+
+
+std::size_t next_node()
+{
+  return (shmem_my_pe() + 1) % shmem_n_pes();
+}
+
+std::atomic<int> greeter{-1};
+
+void greet(int from)
+{
+  greeter = from;
+}
+
+int echo(int value)
+{
+  return value;
+}
+
+// every node sends a message from a global's constructor, while the receiver may still be constructing its own globals
+// the receiver registers the message's invoker before its system_context_ can receive anything, so it recognizes the message
+struct greet_next_node
+{
+  greet_next_node()
+  {
+    system_context().one_sided_execute(next_node(), greet, shmem_my_pe());
+  }
+};
+
+greet_next_node greeting;
+
+int main()
+{
+  // a request sent first thing in main() finds its receiver ready, too
+  int value = 7 + shmem_my_pe();
+  int result = system_context().two_sided_execute(next_node(), echo, value).get();
+  assert(result == value);
+
+  system_context().wait_for_all();
+  shmem_barrier_all();
+
+  int expected_greeter = (shmem_my_pe() + shmem_n_pes() - 1) % shmem_n_pes();
+  assert(greeter == expected_greeter);
+
+  std::cout << "PE " << shmem_my_pe() << ": Greeted by PE " << greeter << " during startup" << std::endl;
+  std::cout << "PE " << shmem_my_pe() << ": PE " << next_node() << " echoed " << result << std::endl;
+
+  shmem_barrier_all();
+}
@@ -0,0 +1,505 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#include "serialization.hpp"
+
+
+// define ACTIVE_MESSAGE_DISABLE_STATISTICS to compile out all instrumentation
+// when disabled, statistics_collector's functions are empty and its snapshots are zero
+
+
+// execution_statistics is a snapshot of the counters collected on a single node
+// (or the sum of several snapshots, see operator+=)
+struct execution_statistics
+{
+  static const std::size_t max_handler_count = 16;
+
+  // bucket i of a histogram counts durations within [2^i, 2^(i+1)) nanoseconds
+  static const std::size_t histogram_bucket_count = 40;
+
+  // traffic, indexed by handler id
+  std::uint64_t messages_sent[max_handler_count];
+  std::uint64_t bytes_sent[max_handler_count];
+  std::uint64_t messages_received[max_handler_count];
+  std::uint64_t bytes_received[max_handler_count];
+
+  // handler run time, indexed by handler id
+  std::uint64_t handler_nanoseconds[max_handler_count];
+  std::uint64_t handler_histogram[max_handler_count][histogram_bucket_count];
+
+  // promise table traffic
+  std::uint64_t promises_added;
+  std::uint64_t promises_removed;
+
+  // promises removed because their deadlines passed or their requests were cancelled,
+  // and replies which arrived for promises which had already been removed
+  std::uint64_t promises_timed_out;
+  std::uint64_t promises_cancelled;
+  std::uint64_t late_replies;
+
+  // polling loop
+  std::uint64_t busy_polls;
+  std::uint64_t idle_polls;
+  std::uint64_t busy_poll_nanoseconds;
+  std::uint64_t idle_poll_nanoseconds;
+
+  inline execution_statistics()
+  {
+    std::fill_n(&messages_sent[0],      max_handler_count, 0);
+    std::fill_n(&bytes_sent[0],         max_handler_count, 0);
+    std::fill_n(&messages_received[0],  max_handler_count, 0);
+    std::fill_n(&bytes_received[0],     max_handler_count, 0);
+    std::fill_n(&handler_nanoseconds[0], max_handler_count, 0);
+    std::fill_n(&handler_histogram[0][0], max_handler_count * histogram_bucket_count, 0);
+
+    promises_added = 0;
+    promises_removed = 0;
+    promises_timed_out = 0;
+    promises_cancelled = 0;
+    late_replies = 0;
+
+    busy_polls = 0;
+    idle_polls = 0;
+    busy_poll_nanoseconds = 0;
+    idle_poll_nanoseconds = 0;
+  }
+
+  // the number of promises waiting on a reply
+  inline std::uint64_t promise_occupancy() const
+  {
+    return promises_added - promises_removed;
+  }
+
+  // the fraction of polling time spent in polls which dispatched at least one handler
+  inline double poll_busy_ratio() const
+  {
+    std::uint64_t total = busy_poll_nanoseconds + idle_poll_nanoseconds;
+    return total == 0 ? 0.0 : static_cast<double>(busy_poll_nanoseconds) / total;
+  }
+
+  inline execution_statistics& operator+=(const execution_statistics& other)
+  {
+    for(std::size_t i = 0; i < max_handler_count; ++i)
+    {
+      messages_sent[i]       += other.messages_sent[i];
+      bytes_sent[i]          += other.bytes_sent[i];
+      messages_received[i]   += other.messages_received[i];
+      bytes_received[i]      += other.bytes_received[i];
+      handler_nanoseconds[i] += other.handler_nanoseconds[i];
+
+      for(std::size_t j = 0; j < histogram_bucket_count; ++j)
+      {
+        handler_histogram[i][j] += other.handler_histogram[i][j];
+      }
+    }
+
+    promises_added   += other.promises_added;
+    promises_removed += other.promises_removed;
+
+    promises_timed_out += other.promises_timed_out;
+    promises_cancelled += other.promises_cancelled;
+    late_replies       += other.late_replies;
+
+    busy_polls            += other.busy_polls;
+    idle_polls            += other.idle_polls;
+    busy_poll_nanoseconds += other.busy_poll_nanoseconds;
+    idle_poll_nanoseconds += other.idle_poll_nanoseconds;
+
+    return *this;
+  }
+
+  template<class OutputArchive>
+  friend void serialize(OutputArchive& ar, const execution_statistics& self)
+  {
+    serialize_counters(ar, self.messages_sent,       max_handler_count);
+    serialize_counters(ar, self.bytes_sent,          max_handler_count);
+    serialize_counters(ar, self.messages_received,   max_handler_count);
+    serialize_counters(ar, self.bytes_received,      max_handler_count);
+    serialize_counters(ar, self.handler_nanoseconds, max_handler_count);
+    serialize_counters(ar, &self.handler_histogram[0][0], max_handler_count * histogram_bucket_count);
+
+    ar(self.promises_added, self.promises_removed);
+    ar(self.promises_timed_out, self.promises_cancelled, self.late_replies);
+    ar(self.busy_polls, self.idle_polls, self.busy_poll_nanoseconds, self.idle_poll_nanoseconds);
+  }
+
+  template<class InputArchive>
+  friend void deserialize(InputArchive& ar, execution_statistics& self)
+  {
+    deserialize_counters(ar, self.messages_sent,       max_handler_count);
+    deserialize_counters(ar, self.bytes_sent,          max_handler_count);
+    deserialize_counters(ar, self.messages_received,   max_handler_count);
+    deserialize_counters(ar, self.bytes_received,      max_handler_count);
+    deserialize_counters(ar, self.handler_nanoseconds, max_handler_count);
+    deserialize_counters(ar, &self.handler_histogram[0][0], max_handler_count * histogram_bucket_count);
+
+    ar(self.promises_added, self.promises_removed);
+    ar(self.promises_timed_out, self.promises_cancelled, self.late_replies);
+    ar(self.busy_polls, self.idle_polls, self.busy_poll_nanoseconds, self.idle_poll_nanoseconds);
+  }
+
+  private:
+    template<class OutputArchive>
+    static void serialize_counters(OutputArchive& ar, const std::uint64_t* counters, std::size_t n)
+    {
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        serialize(ar, counters[i]);
+      }
+    }
+
+    template<class InputArchive>
+    static void deserialize_counters(InputArchive& ar, std::uint64_t* counters, std::size_t n)
+    {
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        deserialize(ar, counters[i]);
+      }
+    }
+};
+
+
+// statistics_collector records events into counters owned by the calling thread
+// each counter has a single writer, so recording is a relaxed load and store without contention
+// snapshot() merges the counters of every thread, including threads which have exited
+class statistics_collector
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    inline static void record_send(int handler_id, std::size_t num_bytes)
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+      counters& c = this_thread_counters();
+      increment(c.messages_sent[index(handler_id)]);
+      increment(c.bytes_sent[index(handler_id)], num_bytes);
+#endif
+    }
+
+    inline static void record_receive(int handler_id, std::size_t num_bytes)
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+      counters& c = this_thread_counters();
+      increment(c.messages_received[index(handler_id)]);
+      increment(c.bytes_received[index(handler_id)], num_bytes);
+#endif
+    }
+
+    inline static void record_handler_time(int handler_id, clock::duration duration)
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+      std::uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+
+      counters& c = this_thread_counters();
+      increment(c.handler_nanoseconds[index(handler_id)], ns);
+      increment(c.handler_histogram[index(handler_id)][bucket(ns)]);
+#endif
+    }
+
+    inline static void record_promise_added()
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+      increment(this_thread_counters().promises_added);
+#endif
+    }
+
+    inline static void record_promise_removed()
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+      increment(this_thread_counters().promises_removed);
+#endif
+    }
+
+    inline static void record_promise_timed_out()
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+      increment(this_thread_counters().promises_timed_out);
+#endif
+    }
+
+    inline static void record_promise_cancelled()
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+      increment(this_thread_counters().promises_cancelled);
+#endif
+    }
+
+    inline static void record_late_reply()
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+      increment(this_thread_counters().late_replies);
+#endif
+    }
+
+    inline static void record_poll(bool busy, clock::duration duration)
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+      std::uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+
+      counters& c = this_thread_counters();
+      if(busy)
+      {
+        increment(c.busy_polls);
+        increment(c.busy_poll_nanoseconds, ns);
+      }
+      else
+      {
+        increment(c.idle_polls);
+        increment(c.idle_poll_nanoseconds, ns);
+      }
+#endif
+    }
+
+    // the number of messages received by the calling thread so far
+    // the polling loop compares this before and after a poll to tell whether the poll did any work
+    inline static std::uint64_t messages_received_by_this_thread()
+    {
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+      counters& c = this_thread_counters();
+
+      std::uint64_t result = 0;
+      for(const std::atomic<std::uint64_t>& counter : c.messages_received)
+      {
+        result += counter.load(std::memory_order_relaxed);
+      }
+
+      return result;
+#else
+      return 0;
+#endif
+    }
+
+    inline static execution_statistics snapshot()
+    {
+      execution_statistics result;
+
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+      registry& r = the_registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+
+      result = r.retired;
+      for(const counters* c : r.live)
+      {
+        result += c->load();
+      }
+#endif
+
+      return result;
+    }
+
+    // times the execution of a handler and counts the message it received
+    class handler_scope
+    {
+      public:
+        inline handler_scope(int handler_id, std::size_t num_bytes)
+          : handler_id_(handler_id)
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+            , start_(clock::now())
+#endif
+        {
+          record_receive(handler_id_, num_bytes);
+        }
+
+        inline ~handler_scope()
+        {
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+          record_handler_time(handler_id_, clock::now() - start_);
+#endif
+        }
+
+      private:
+        int handler_id_;
+#ifndef ACTIVE_MESSAGE_DISABLE_STATISTICS
+        clock::time_point start_;
+#endif
+    };
+
+  private:
+    static const std::size_t max_handler_count = execution_statistics::max_handler_count;
+    static const std::size_t histogram_bucket_count = execution_statistics::histogram_bucket_count;
+
+    struct counters
+    {
+      std::atomic<std::uint64_t> messages_sent[max_handler_count];
+      std::atomic<std::uint64_t> bytes_sent[max_handler_count];
+      std::atomic<std::uint64_t> messages_received[max_handler_count];
+      std::atomic<std::uint64_t> bytes_received[max_handler_count];
+      std::atomic<std::uint64_t> handler_nanoseconds[max_handler_count];
+      std::atomic<std::uint64_t> handler_histogram[max_handler_count][histogram_bucket_count];
+      std::atomic<std::uint64_t> promises_added;
+      std::atomic<std::uint64_t> promises_removed;
+      std::atomic<std::uint64_t> promises_timed_out;
+      std::atomic<std::uint64_t> promises_cancelled;
+      std::atomic<std::uint64_t> late_replies;
+      std::atomic<std::uint64_t> busy_polls;
+      std::atomic<std::uint64_t> idle_polls;
+      std::atomic<std::uint64_t> busy_poll_nanoseconds;
+      std::atomic<std::uint64_t> idle_poll_nanoseconds;
+
+      inline counters()
+      {
+        for(std::size_t i = 0; i < max_handler_count; ++i)
+        {
+          messages_sent[i].store(0, std::memory_order_relaxed);
+          bytes_sent[i].store(0, std::memory_order_relaxed);
+          messages_received[i].store(0, std::memory_order_relaxed);
+          bytes_received[i].store(0, std::memory_order_relaxed);
+          handler_nanoseconds[i].store(0, std::memory_order_relaxed);
+
+          for(std::size_t j = 0; j < histogram_bucket_count; ++j)
+          {
+            handler_histogram[i][j].store(0, std::memory_order_relaxed);
+          }
+        }
+
+        promises_added.store(0, std::memory_order_relaxed);
+        promises_removed.store(0, std::memory_order_relaxed);
+        promises_timed_out.store(0, std::memory_order_relaxed);
+        promises_cancelled.store(0, std::memory_order_relaxed);
+        late_replies.store(0, std::memory_order_relaxed);
+        busy_polls.store(0, std::memory_order_relaxed);
+        idle_polls.store(0, std::memory_order_relaxed);
+        busy_poll_nanoseconds.store(0, std::memory_order_relaxed);
+        idle_poll_nanoseconds.store(0, std::memory_order_relaxed);
+      }
+
+      inline execution_statistics load() const
+      {
+        execution_statistics result;
+
+        for(std::size_t i = 0; i < max_handler_count; ++i)
+        {
+          result.messages_sent[i]       = messages_sent[i].load(std::memory_order_relaxed);
+          result.bytes_sent[i]          = bytes_sent[i].load(std::memory_order_relaxed);
+          result.messages_received[i]   = messages_received[i].load(std::memory_order_relaxed);
+          result.bytes_received[i]      = bytes_received[i].load(std::memory_order_relaxed);
+          result.handler_nanoseconds[i] = handler_nanoseconds[i].load(std::memory_order_relaxed);
+
+          for(std::size_t j = 0; j < histogram_bucket_count; ++j)
+          {
+            result.handler_histogram[i][j] = handler_histogram[i][j].load(std::memory_order_relaxed);
+          }
+        }
+
+        result.promises_added        = promises_added.load(std::memory_order_relaxed);
+        result.promises_removed      = promises_removed.load(std::memory_order_relaxed);
+        result.promises_timed_out    = promises_timed_out.load(std::memory_order_relaxed);
+        result.promises_cancelled    = promises_cancelled.load(std::memory_order_relaxed);
+        result.late_replies          = late_replies.load(std::memory_order_relaxed);
+        result.busy_polls            = busy_polls.load(std::memory_order_relaxed);
+        result.idle_polls            = idle_polls.load(std::memory_order_relaxed);
+        result.busy_poll_nanoseconds = busy_poll_nanoseconds.load(std::memory_order_relaxed);
+        result.idle_poll_nanoseconds = idle_poll_nanoseconds.load(std::memory_order_relaxed);
+
+        return result;
+      }
+    };
+
+    struct registry
+    {
+      std::mutex mutex;
+      std::vector<const counters*> live;
+      execution_statistics retired;
+    };
+
+    // the registry is intentionally leaked so that threads which exit during
+    // static destruction (e.g., the polling thread) can still retire their counters
+    inline static registry& the_registry()
+    {
+      static registry* result = new registry;
+      return *result;
+    }
+
+    // registers the calling thread's counters on construction and folds them into
+    // the registry's retired total on thread exit
+    class registration
+    {
+      public:
+        inline registration()
+        {
+          registry& r = the_registry();
+          std::lock_guard<std::mutex> lock(r.mutex);
+          r.live.push_back(&counters_);
+        }
+
+        inline ~registration()
+        {
+          registry& r = the_registry();
+          std::lock_guard<std::mutex> lock(r.mutex);
+          r.retired += counters_.load();
+          r.live.erase(std::find(r.live.begin(), r.live.end(), &counters_));
+        }
+
+        inline counters& get()
+        {
+          return counters_;
+        }
+
+      private:
+        counters counters_;
+    };
+
+    inline static counters& this_thread_counters()
+    {
+      static thread_local registration result;
+      return result.get();
+    }
+
+    inline static void increment(std::atomic<std::uint64_t>& counter, std::uint64_t amount = 1)
+    {
+      // only the owning thread writes to counter, so this needn't be an atomic read-modify-write
+      counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    inline static std::size_t index(int handler_id)
+    {
+      // lump out-of-range handler ids into the final slot
+      return std::min<std::size_t>(handler_id, max_handler_count - 1);
+    }
+
+    inline static std::size_t bucket(std::uint64_t ns)
+    {
+      std::size_t result = 0;
+
+#if defined(__GNUC__)
+      result = ns == 0 ? 0 : 63 - __builtin_clzll(ns);
+#else
+      while(ns >>= 1) ++result;
+#endif
+
+      return std::min(result, histogram_bucket_count - 1);
+    }
+};
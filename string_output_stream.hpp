@@ -0,0 +1,121 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+
+// basic_string_output_stream appends to a caller-provided string, which may use any allocator
+// unlike std::stringstream, the result needn't be copied out of the stream with str()
+// seeking back to a position already written lets a writer go back and fill in what it skipped, e.g. a length prefix
+template<class String>
+class basic_string_output_stream : public std::ostream
+{
+  public:
+    inline explicit basic_string_output_stream(String& string)
+      : std::ostream(),
+        buffer_(string)
+    {
+      // pass buffer_ to ostream *after* buffer_ has been constructed
+      std::ostream::rdbuf(&buffer_);
+    }
+
+  private:
+    class string_buffer : public std::streambuf
+    {
+      public:
+        inline explicit string_buffer(String& string)
+          : string_(string),
+            position_(string.size())
+        {}
+
+        string_buffer(const string_buffer&) = delete;
+
+      protected:
+        inline int_type overflow(int_type c) override
+        {
+          if(!traits_type::eq_int_type(c, traits_type::eof()))
+          {
+            char_type character = traits_type::to_char_type(c);
+            put(&character, 1);
+          }
+
+          return traits_type::not_eof(c);
+        }
+
+        inline std::streamsize xsputn(const char_type* data, std::streamsize size) override
+        {
+          put(data, size);
+          return size;
+        }
+
+        inline pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override
+        {
+          off_type base = direction == std::ios_base::beg ? 0 :
+                          direction == std::ios_base::cur ? static_cast<off_type>(position_) :
+                          static_cast<off_type>(string_.size());
+
+          return seekpos(pos_type(base + offset), which);
+        }
+
+        // positions are offsets into the string, and only those already written may be sought
+        inline pos_type seekpos(pos_type position, std::ios_base::openmode which) override
+        {
+          off_type offset = position;
+
+          if(!(which & std::ios_base::out) || offset < 0 || static_cast<std::size_t>(offset) > string_.size())
+          {
+            return pos_type(off_type(-1));
+          }
+
+          position_ = static_cast<std::size_t>(offset);
+          return position;
+        }
+
+      private:
+        // overwrites what follows the position, and appends what extends past the end
+        inline void put(const char_type* data, std::size_t size)
+        {
+          std::size_t overwritten = std::min(size, string_.size() - position_);
+          traits_type::copy(&string_[position_], data, overwritten);
+
+          string_.append(data + overwritten, size - overwritten);
+          position_ += size;
+        }
+
+        String& string_;
+        std::size_t position_;
+    };
+
+    string_buffer buffer_;
+};
+
+using string_output_stream = basic_string_output_stream<std::string>;
@@ -0,0 +1,89 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// $ ./openshmem-am-root/bin/oshc++ -std=c++11 task_graph.cpp 
+// $ ./openshmem-am-root/bin/oshrun ./a.out -n 2
+// PE 1: load() -> 7
+// PE 0: square(7) -> 49
+// PE 1: cube(7) -> 343
+// PE 0: sum(49, 343) -> 392
+// PE 0: The result is 392
+
+#include <iostream>
+#include <cassert>
+
+#include "task_graph.hpp"
+
+
+int load()
+{
+  std::cout << "PE " << shmem_my_pe() << ": load() -> 7" << std::endl;
+  return 7;
+}
+
+int square(int x)
+{
+  std::cout << "PE " << shmem_my_pe() << ": square(" << x << ") -> " << x * x << std::endl;
+  return x * x;
+}
+
+int cube(int x)
+{
+  std::cout << "PE " << shmem_my_pe() << ": cube(" << x << ") -> " << x * x * x << std::endl;
+  return x * x * x;
+}
+
+int sum(int x, int y)
+{
+  std::cout << "PE " << shmem_my_pe() << ": sum(" << x << ", " << y << ") -> " << x + y << std::endl;
+  return x + y;
+}
+
+int main()
+{
+  if(shmem_my_pe() == 0)
+  {
+    // a diamond: load's result travels from PE 1 to both square and cube,
+    // and their results travel to sum without passing through PE 0's driver
+    task_graph graph;
+
+    task<int> x = graph.add(1, load);
+    task<int> y = graph.add(0, square, x);
+    task<int> z = graph.add(1, cube, x);
+    task<int> result = graph.add(0, sum, y, z);
+
+    std::future<int> future = graph.get_future(result);
+
+    graph.run();
+
+    int value = future.get();
+    assert(value == 392);
+
+    std::cout << "PE 0: The result is " << value << std::endl;
+  }
+
+  shmem_barrier_all();
+}
@@ -0,0 +1,512 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <string>
+#include <future>
+#include <functional>
+#include <utility>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "serialization.hpp"
+#include "execution_context.hpp"
+#include "remote_executor.hpp"
+#include "cluster_executor.hpp"
+#include "integer_sequence.hpp"
+
+
+// task<T> refers to a task of a task_graph whose result is a T
+// passing a task<T> to task_graph::add() as an argument makes the new task consume its result
+template<class T>
+class task
+{
+  public:
+    using result_type = T;
+
+    inline std::size_t id() const
+    {
+      return id_;
+    }
+
+  private:
+    friend class task_graph;
+
+    inline task(std::uint64_t graph, std::size_t id)
+      : graph_(graph),
+        id_(id)
+    {}
+
+    // the id of the task_graph the task belongs to
+    std::uint64_t graph_;
+    std::size_t id_;
+};
+
+
+// under key_affinity, a cluster_executor hashes a task by its id,
+// so tasks which consume the same task's result first execute on the same node
+namespace std
+{
+
+template<class T>
+struct hash<::task<T>>
+{
+  inline std::size_t operator()(const ::task<T>& t) const
+  {
+    return std::hash<std::size_t>()(t.id());
+  }
+};
+
+} // end std
+
+
+template<class T>
+struct is_task : std::false_type {};
+
+template<class T>
+struct is_task<task<T>> : std::true_type {};
+
+
+// the type of the parameter a task receives for one of the arguments given to task_graph::add():
+// the result of a task<T>, or else the argument itself
+template<class Arg, class Decayed = typename std::decay<Arg>::type>
+struct task_argument
+{
+  using type = Decayed;
+};
+
+template<class Arg, class T>
+struct task_argument<Arg, task<T>>
+{
+  using type = T;
+};
+
+template<class Arg>
+using task_argument_t = typename task_argument<Arg>::type;
+
+
+// an edge of a task_graph: the consumer task on node which receives a result as its argument number slot
+struct task_graph_edge
+{
+  std::size_t node;
+  std::size_t task;
+  std::size_t slot;
+
+  template<class OutputArchive>
+  friend void serialize(OutputArchive& ar, const task_graph_edge& self)
+  {
+    ar(self.node, self.task, self.slot);
+  }
+
+  template<class InputArchive>
+  friend void deserialize(InputArchive& ar, task_graph_edge& self)
+  {
+    ar(self.node, self.task, self.slot);
+  }
+};
+
+
+// task_graph executes a DAG of remote calls
+// each task is a function, the node which executes it, and its arguments, some of which may be the results of other tasks
+//
+// the graph's driver sends each task to its node once, when run() is called
+// a task executes as soon as its inputs arrive, and its node sends its serialized result straight to the nodes
+// of the tasks which consume it, so results never pass through the driver unless it asks for them with get_future()
+//
+// tasks must return a value
+// a task which throws doesn't execute the tasks which consume its result; instead, the futures of the tasks which depend on it
+// receive a remote_error carrying the exception's what()
+class task_graph
+{
+  public:
+    inline task_graph()
+      : id_(make_graph_id()),
+        has_run_(false)
+    {}
+
+    // adds the task f(args...), which executes on node
+    // arguments which are task<T>s are replaced by the results of those tasks
+    template<class Function, class... Args,
+             class Result = invoke_result_t<typename std::decay<Function>::type,task_argument_t<Args>...>,
+             __REQUIRES(!std::is_void<Result>::value),
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,task_argument_t<Args>...,Result>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,task_argument_t<Args>...,Result>::value)
+            >
+    task<Result> add(std::size_t node, Function&& f, Args&&... args)
+    {
+      if(node >= system_context().node_count())
+      {
+        throw std::runtime_error("task_graph::add(): Invalid node index.");
+      }
+
+      std::size_t id = tasks_.size();
+
+      // serialize the constant arguments and check the task arguments before changing the graph,
+      // so that an argument which throws leaves the graph as it was
+      std::vector<std::pair<std::size_t,std::string>> constants;
+      std::vector<std::pair<std::size_t,task_graph_edge>> edges;
+      add_arguments(task_graph_edge{node, id, 0}, constants, edges, make_index_sequence<sizeof...(Args)>(), std::forward<Args>(args)...);
+
+      using function_type = typename std::decay<Function>::type;
+      function_type function = std::forward<Function>(f);
+      std::size_t arity = sizeof...(Args);
+
+      task_record record;
+      record.node = node;
+      record.send = [function, arity, constants](std::size_t node, std::uint64_t graph, std::size_t task, const std::vector<task_graph_edge>& consumers)
+      {
+        // a dropped task would leave its consumers waiting forever, so tasks are sent whatever the context's flow_control_policy
+        system_context().one_sided_execute(flow_control_policy::block, message_priority::normal, node, &instantiate<function_type,task_argument_t<Args>...>, graph, task, function, arity, constants, consumers);
+      };
+
+      tasks_.push_back(std::move(record));
+
+      // connect the task arguments
+      for(const std::pair<std::size_t,task_graph_edge>& edge : edges)
+      {
+        tasks_[edge.first].consumers.push_back(edge.second);
+      }
+
+      return task<Result>(id_, id);
+    }
+
+    // adds a task which executes on the node executor refers to
+    template<class Function, class... Args>
+    auto add(const remote_executor& executor, Function&& f, Args&&... args)
+      -> decltype(std::declval<task_graph&>().add(std::size_t(), std::forward<Function>(f), std::forward<Args>(args)...))
+    {
+      return add(executor.node(), std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    // adds a task which executes on a node chosen by executor, which chooses when the task is added
+    template<class Function, class... Args>
+    auto add(const cluster_executor& executor, Function&& f, Args&&... args)
+      -> decltype(std::declval<task_graph&>().add(std::size_t(), std::forward<Function>(f), std::forward<Args>(args)...))
+    {
+      return add(executor.select_node(args...), std::forward<Function>(f), std::forward<Args>(args)...);
+    }
+
+    // returns a future for the result of t, which is sent to this node when t finishes
+    // if t, or a task it depends on, throws, the future receives a remote_error
+    // must be called before run(), and at most once for each task
+    template<class T>
+    std::future<T> get_future(const task<T>& t)
+    {
+      if(has_run_)
+      {
+        throw std::runtime_error("task_graph::get_future(): The graph has already run.");
+      }
+
+      if(t.graph_ != id_)
+      {
+        throw std::runtime_error("task_graph::get_future(): Task does not belong to this graph.");
+      }
+
+      std::shared_ptr<std::promise<T>> promise = std::make_shared<std::promise<T>>();
+
+      {
+        std::lock_guard<std::mutex> lock(results_mutex());
+
+        // like std::promise::get_future(), a second call is an error: the task's single result can fulfill only one future
+        bool inserted = results().emplace(std::make_pair(id_, t.id()), [promise](bool succeeded, const std::string& result)
+        {
+          if(succeeded)
+          {
+            promise->set_value(from_string<T>(result.data(), result.size()));
+          }
+          else
+          {
+            promise->set_exception(std::make_exception_ptr(remote_error(result)));
+          }
+        }).second;
+
+        if(!inserted)
+        {
+          throw std::runtime_error("task_graph::get_future(): The task's future has already been retrieved.");
+        }
+      }
+
+      tasks_[t.id()].consumers.push_back(task_graph_edge{static_cast<std::size_t>(shmem_my_pe()), t.id(), result_slot});
+
+      return promise->get_future();
+    }
+
+    // sends every task to its node
+    // tasks without task arguments begin executing immediately
+    inline void run()
+    {
+      if(has_run_)
+      {
+        throw std::runtime_error("task_graph::run(): The graph has already run.");
+      }
+
+      has_run_ = true;
+
+      for(std::size_t task = 0; task < tasks_.size(); ++task)
+      {
+        tasks_[task].send(tasks_[task].node, id_, task, tasks_[task].consumers);
+      }
+    }
+
+    inline std::size_t size() const
+    {
+      return tasks_.size();
+    }
+
+  private:
+    // the slot of an edge which delivers a result to the driver
+    static const std::size_t result_slot = std::numeric_limits<std::size_t>::max();
+
+    inline static std::uint64_t make_graph_id()
+    {
+      static std::atomic<std::uint64_t> counter{0};
+
+      // the high bits of the id identify the driver
+      return (static_cast<std::uint64_t>(shmem_my_pe()) << 40) | counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // the edges are pairs of a producer and the edge to its consumer
+    template<size_t... Indices, class... Args>
+    void add_arguments(const task_graph_edge& consumer,
+                       std::vector<std::pair<std::size_t,std::string>>& constants,
+                       std::vector<std::pair<std::size_t,task_graph_edge>>& edges,
+                       index_sequence<Indices...>, Args&&... args) const
+    {
+      int unused[] = {0, (add_argument(task_graph_edge{consumer.node, consumer.task, Indices}, constants, edges, std::forward<Args>(args)), 0)...};
+      (void)unused;
+
+      // a task without arguments doesn't use consumer
+      (void)consumer;
+    }
+
+    template<class T>
+    void add_argument(const task_graph_edge& consumer,
+                      std::vector<std::pair<std::size_t,std::string>>&,
+                      std::vector<std::pair<std::size_t,task_graph_edge>>& edges,
+                      const task<T>& producer) const
+    {
+      if(producer.graph_ != id_)
+      {
+        throw std::runtime_error("task_graph::add(): Task argument does not belong to this graph.");
+      }
+
+      edges.emplace_back(producer.id(), consumer);
+    }
+
+    template<class Arg,
+             __REQUIRES(!is_task<typename std::decay<Arg>::type>::value)
+            >
+    void add_argument(const task_graph_edge& consumer,
+                      std::vector<std::pair<std::size_t,std::string>>& constants,
+                      std::vector<std::pair<std::size_t,task_graph_edge>>&,
+                      Arg&& arg) const
+    {
+      constants.emplace_back(consumer.slot, to_string(static_cast<const typename std::decay<Arg>::type&>(arg)));
+    }
+
+    // the driver's record of a task
+    struct task_record
+    {
+      std::size_t node;
+      std::vector<task_graph_edge> consumers;
+      std::function<void(std::size_t, std::uint64_t, std::size_t, const std::vector<task_graph_edge>&)> send;
+    };
+
+    // a task waiting on the node which executes it
+    // its inputs may begin arriving before the task itself does
+    struct pending_task
+    {
+      std::vector<std::string> inputs;
+      std::size_t num_inputs_received = 0;
+      std::size_t arity = 0;
+      std::function<std::string(const std::vector<std::string>&)> body;
+      std::vector<task_graph_edge> consumers;
+
+      // the what() of the first failure among the task's inputs
+      bool failed = false;
+      std::string error;
+    };
+
+    using task_key = std::pair<std::uint64_t,std::size_t>;
+
+    inline static std::mutex& pending_tasks_mutex()
+    {
+      static std::mutex result;
+      return result;
+    }
+
+    inline static std::map<task_key, pending_task>& pending_tasks()
+    {
+      static std::map<task_key, pending_task> result;
+      return result;
+    }
+
+    // the driver's futures, keyed by the task whose result they receive
+    inline static std::mutex& results_mutex()
+    {
+      static std::mutex result;
+      return result;
+    }
+
+    // each function receives whether the task succeeded, and its serialized result or the what() of its failure
+    inline static std::map<task_key, std::function<void(bool, const std::string&)>>& results()
+    {
+      static std::map<task_key, std::function<void(bool, const std::string&)>> result;
+      return result;
+    }
+
+    template<class Function, class... Params, size_t... Indices>
+    static std::string invoke(Function& f, const std::vector<std::string>& inputs, index_sequence<Indices...>)
+    {
+      return to_string(f(from_string<Params>(inputs[Indices].data(), inputs[Indices].size())...));
+    }
+
+    // this function is what the driver sends to the node which executes a task
+    template<class Function, class... Params>
+    static void instantiate(std::uint64_t graph, std::size_t task, Function f, std::size_t arity,
+                            std::vector<std::pair<std::size_t,std::string>> constants, std::vector<task_graph_edge> consumers)
+    {
+      std::unique_lock<std::mutex> lock(pending_tasks_mutex());
+
+      pending_task& pending = pending_tasks()[task_key(graph, task)];
+
+      if(pending.inputs.size() < arity)
+      {
+        pending.inputs.resize(arity);
+      }
+
+      for(std::pair<std::size_t,std::string>& constant : constants)
+      {
+        pending.inputs[constant.first] = std::move(constant.second);
+        ++pending.num_inputs_received;
+      }
+
+      pending.arity = arity;
+      pending.consumers = std::move(consumers);
+      pending.body = [f](const std::vector<std::string>& inputs) mutable
+      {
+        return invoke<Function,Params...>(f, inputs, make_index_sequence<sizeof...(Params)>());
+      };
+
+      execute_if_ready(task_key(graph, task), lock);
+    }
+
+    // this function is what a task's node sends to the nodes which consume its result
+    // input is the serialized result, or the what() of the failure if the task didn't succeed
+    inline static void deliver(std::uint64_t graph, std::size_t task, std::size_t slot, bool succeeded, std::string input)
+    {
+      if(slot == result_slot)
+      {
+        std::function<void(bool, const std::string&)> fulfill;
+
+        {
+          std::lock_guard<std::mutex> lock(results_mutex());
+          auto found = results().find(task_key(graph, task));
+          fulfill = std::move(found->second);
+          results().erase(found);
+        }
+
+        fulfill(succeeded, input);
+        return;
+      }
+
+      std::unique_lock<std::mutex> lock(pending_tasks_mutex());
+
+      pending_task& pending = pending_tasks()[task_key(graph, task)];
+
+      if(pending.inputs.size() <= slot)
+      {
+        pending.inputs.resize(slot + 1);
+      }
+
+      if(succeeded)
+      {
+        pending.inputs[slot] = std::move(input);
+      }
+      else if(!pending.failed)
+      {
+        pending.failed = true;
+        pending.error = std::move(input);
+      }
+
+      ++pending.num_inputs_received;
+
+      execute_if_ready(task_key(graph, task), lock);
+    }
+
+    // executes the task once it and all of its inputs have arrived, and then forwards its result
+    // a task whose inputs include a failure forwards that failure rather than execute
+    inline static void execute_if_ready(const task_key& key, std::unique_lock<std::mutex>& lock)
+    {
+      auto found = pending_tasks().find(key);
+
+      if(!found->second.body || found->second.num_inputs_received < found->second.arity) return;
+
+      pending_task ready = std::move(found->second);
+      pending_tasks().erase(found);
+
+      lock.unlock();
+
+      bool succeeded = !ready.failed;
+      std::string result = std::move(ready.error);
+
+      if(succeeded)
+      {
+        try
+        {
+          result = ready.body(ready.inputs);
+        }
+        catch(const std::exception& e)
+        {
+          succeeded = false;
+          result = e.what();
+        }
+        catch(...)
+        {
+          succeeded = false;
+          result = "unknown exception";
+        }
+      }
+
+      for(const task_graph_edge& consumer : ready.consumers)
+      {
+        // like tasks, results mustn't be dropped; when this executes in a handler, results which exceed their credit window are spilled
+        system_context().one_sided_execute(flow_control_policy::block, message_priority::normal, consumer.node, &deliver, key.first, consumer.task, consumer.slot, succeeded, result);
+      }
+    }
+
+    std::uint64_t id_;
+    bool has_run_;
+    std::vector<task_record> tasks_;
+};
@@ -0,0 +1,173 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <functional>
+#include <utility>
+#include <algorithm>
+
+
+// timer_wheel is a hashed timing wheel: a timer is filed in the slot its deadline's tick hashes to,
+// so scheduling a timer and advancing the wheel past it are both O(1)
+// timers whose deadlines are more than one revolution away wait for the wheel to come around again
+// cancelling a timer is also O(1), so a timer whose purpose is served early needn't be kept until its deadline
+class timer_wheel
+{
+  public:
+    using clock = std::chrono::steady_clock;
+    using callback_type = std::function<void()>;
+
+    // identifies a scheduled timer so that it can be cancelled
+    // no_timer is never returned by schedule()
+    using handle = std::uint64_t;
+    static const handle no_timer = 0;
+
+    inline timer_wheel(clock::duration tick, std::size_t num_slots)
+      : tick_(tick),
+        slots_(num_slots),
+        start_(clock::now()),
+        current_tick_(0),
+        next_handle_(no_timer + 1)
+    {}
+
+    // arranges for callback to be called by the first call to advance() at or after deadline
+    inline handle schedule(clock::time_point deadline, callback_type callback)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      // round up so that timers never fire early, and never file a timer in a slot which has already been visited
+      std::size_t deadline_tick = std::max(ticks_since_start(deadline + tick_ - clock::duration(1)), current_tick_ + 1);
+      std::size_t ticks_away = deadline_tick - current_tick_;
+
+      handle result = next_handle_++;
+
+      std::list<timer>& slot = slots_[deadline_tick % slots_.size()];
+      slot.push_back(timer{(ticks_away - 1) / slots_.size(), result, std::move(callback)});
+      scheduled_.emplace(result, std::make_pair(&slot, std::prev(slot.end())));
+
+      return result;
+    }
+
+    // removes a timer before it fires, and destroys its callback
+    // returns false if the timer has already fired or been cancelled
+    inline bool cancel(handle h)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      auto found = scheduled_.find(h);
+      if(found == scheduled_.end())
+      {
+        return false;
+      }
+
+      found->second.first->erase(found->second.second);
+      scheduled_.erase(found);
+
+      return true;
+    }
+
+    // the number of timers which have been scheduled but have neither fired nor been cancelled
+    inline std::size_t size()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return scheduled_.size();
+    }
+
+    // calls the callbacks of the timers whose deadlines have passed
+    // callbacks are called without holding the wheel's lock, so they may schedule new timers
+    inline void advance(clock::time_point now = clock::now())
+    {
+      std::vector<callback_type> expired;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::size_t now_tick = ticks_since_start(now);
+
+        // visiting an empty slot is cheap, so even a long gap between advances is simply walked tick by tick
+        while(current_tick_ < now_tick)
+        {
+          ++current_tick_;
+          collect_expired(slots_[current_tick_ % slots_.size()], expired);
+        }
+      }
+
+      for(callback_type& callback : expired)
+      {
+        callback();
+      }
+    }
+
+  private:
+    struct timer
+    {
+      std::size_t rounds;
+      handle id;
+      callback_type callback;
+    };
+
+    inline std::size_t ticks_since_start(clock::time_point t) const
+    {
+      return t < start_ ? 0 : (t - start_) / tick_;
+    }
+
+    inline void collect_expired(std::list<timer>& slot, std::vector<callback_type>& expired)
+    {
+      for(auto t = slot.begin(); t != slot.end();)
+      {
+        if(t->rounds == 0)
+        {
+          expired.emplace_back(std::move(t->callback));
+          scheduled_.erase(t->id);
+          t = slot.erase(t);
+        }
+        else
+        {
+          --t->rounds;
+          ++t;
+        }
+      }
+    }
+
+    std::mutex mutex_;
+    clock::duration tick_;
+    std::vector<std::list<timer>> slots_;
+    clock::time_point start_;
+    std::size_t current_tick_;
+
+    // where each scheduled timer is filed, so that it can be cancelled without searching its slot
+    handle next_handle_;
+    std::unordered_map<handle, std::pair<std::list<timer>*, std::list<timer>::iterator>> scheduled_;
+};
+
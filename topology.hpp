@@ -0,0 +1,176 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+// parses a Linux cpu list such as "0-3,8,10-11", the format of /sys/devices/system/node/node*/cpulist
+inline std::vector<int> parse_cpu_list(const std::string& list)
+{
+  std::vector<int> result;
+
+  std::size_t position = 0;
+  while(position < list.size())
+  {
+    std::size_t end = list.find(',', position);
+    if(end == std::string::npos) end = list.size();
+
+    std::string range = list.substr(position, end - position);
+    std::size_t dash = range.find('-');
+
+    if(!range.empty() && range.find_first_not_of(" \n") != std::string::npos)
+    {
+      int first = std::atoi(range.c_str());
+      int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+
+      for(int cpu = first; cpu <= last; ++cpu)
+      {
+        result.push_back(cpu);
+      }
+    }
+
+    position = end + 1;
+  }
+
+  return result;
+}
+
+
+// returns the cpus of each NUMA node, indexed by node id, as reported by /sys
+// returns an empty map if the topology is unavailable
+inline std::map<int, std::vector<int>> numa_topology()
+{
+  std::map<int, std::vector<int>> result;
+
+  std::ifstream online("/sys/devices/system/node/online");
+  std::string nodes;
+  if(!std::getline(online, nodes)) return result;
+
+  for(int node : parse_cpu_list(nodes))
+  {
+    std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+
+    std::string cpus;
+    if(std::getline(cpulist, cpus))
+    {
+      result[node] = parse_cpu_list(cpus);
+    }
+  }
+
+  return result;
+}
+
+
+// returns the cpus the calling thread is allowed to run on
+inline std::vector<int> allowed_cpus()
+{
+  std::vector<int> result;
+
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  if(pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+  {
+    for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+      if(CPU_ISSET(cpu, &set)) result.push_back(cpu);
+    }
+  }
+#endif
+
+  return result;
+}
+
+
+// returns the cpus of the NUMA node the calling thread is currently running on,
+// restricted to those it is allowed to run on
+// returns an empty vector if they can't be determined
+inline std::vector<int> numa_node_cpus_of_this_thread()
+{
+  std::vector<int> result;
+
+#ifdef __linux__
+  int cpu = sched_getcpu();
+  if(cpu < 0) return result;
+
+  std::vector<int> allowed = allowed_cpus();
+
+  for(const auto& node : numa_topology())
+  {
+    const std::vector<int>& cpus = node.second;
+
+    if(std::find(cpus.begin(), cpus.end(), cpu) != cpus.end())
+    {
+      std::vector<int> node_cpus = cpus;
+      std::sort(node_cpus.begin(), node_cpus.end());
+      std::sort(allowed.begin(), allowed.end());
+
+      std::set_intersection(node_cpus.begin(), node_cpus.end(), allowed.begin(), allowed.end(), std::back_inserter(result));
+      break;
+    }
+  }
+#endif
+
+  return result;
+}
+
+
+// restricts the calling thread to the given cpus
+// returns false if cpus is empty or the thread couldn't be pinned
+inline bool pin_this_thread(const std::vector<int>& cpus)
+{
+#ifdef __linux__
+  if(cpus.empty()) return false;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  for(int cpu : cpus)
+  {
+    if(0 <= cpu && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+  }
+
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
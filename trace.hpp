@@ -0,0 +1,227 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+
+
+// define ACTIVE_MESSAGE_ENABLE_TRACING to record trace events
+// when tracing is not enabled, tracer::record() is empty and dumped traces contain no events
+
+// define ACTIVE_MESSAGE_TRACE_CAPACITY to change the number of events retained by each thread
+// it must be a power of two
+#ifndef ACTIVE_MESSAGE_TRACE_CAPACITY
+#define ACTIVE_MESSAGE_TRACE_CAPACITY (1 << 16)
+#endif
+
+
+enum class trace_event_kind : std::uint32_t
+{
+  enqueue          = 0, // a message was created by one_sided_execute or two_sided_execute
+  send             = 1, // a serialized message was handed to shmem
+  handler_enter    = 2, // a handler began deserializing a message
+  activate_done    = 3, // a message's function returned
+  reply_send       = 4, // a serialized reply was handed to shmem
+  future_fulfilled = 5  // a reply fulfilled its promise
+};
+
+
+inline const char* trace_event_name(trace_event_kind kind)
+{
+  switch(kind)
+  {
+    case trace_event_kind::enqueue:          return "enqueue";
+    case trace_event_kind::send:             return "send";
+    case trace_event_kind::handler_enter:    return "handler_enter";
+    case trace_event_kind::activate_done:    return "activate_done";
+    case trace_event_kind::reply_send:       return "reply_send";
+    case trace_event_kind::future_fulfilled: return "future_fulfilled";
+  }
+
+  return "unknown";
+}
+
+
+// trace_event is written to trace files as-is, so it must remain trivially copyable
+struct trace_event
+{
+  std::uint64_t timestamp; // nanoseconds since an arbitrary, per-node epoch (std::chrono::steady_clock)
+  std::uint64_t message_id;
+  std::uint32_t thread;
+  trace_event_kind kind;
+};
+
+
+// the header of a trace file
+// a trace file is a trace_file_header followed by header.event_count trace_events
+struct trace_file_header
+{
+  char magic[8];
+  std::uint32_t node;
+  std::uint32_t event_size;
+  std::uint64_t event_count;
+
+  static const char* expected_magic()
+  {
+    return "AMTRACE1";
+  }
+};
+
+
+// tracer records events into a fixed-size ring buffer owned by the calling thread
+// recording never locks or allocates: once a thread's ring is full, its oldest events are overwritten
+class tracer
+{
+  public:
+    static const std::size_t capacity = ACTIVE_MESSAGE_TRACE_CAPACITY;
+
+    static_assert((capacity & (capacity - 1)) == 0, "ACTIVE_MESSAGE_TRACE_CAPACITY must be a power of two.");
+
+#ifdef ACTIVE_MESSAGE_ENABLE_TRACING
+    inline static void record(trace_event_kind kind, std::uint64_t message_id)
+    {
+      ring& r = this_thread_ring();
+
+      std::uint64_t position = r.head.load(std::memory_order_relaxed);
+
+      trace_event& e = r.events[position & (capacity - 1)];
+      e.timestamp = now();
+      e.message_id = message_id;
+      e.thread = r.thread;
+      e.kind = kind;
+
+      r.head.store(position + 1, std::memory_order_release);
+    }
+#else
+    // without tracing, recording compiles to nothing
+    inline static void record(trace_event_kind, std::uint64_t)
+    {
+    }
+#endif
+
+    // returns the events currently retained by every thread's ring
+    // events recorded concurrently with collect() may be torn; collect while quiescent for an exact trace
+    inline static std::vector<trace_event> collect()
+    {
+      std::vector<trace_event> result;
+
+#ifdef ACTIVE_MESSAGE_ENABLE_TRACING
+      registry& reg = the_registry();
+      std::lock_guard<std::mutex> lock(reg.mutex);
+
+      for(const ring* r : reg.rings)
+      {
+        std::uint64_t head = r->head.load(std::memory_order_acquire);
+        std::uint64_t first = head > capacity ? head - capacity : 0;
+
+        for(std::uint64_t i = first; i < head; ++i)
+        {
+          result.push_back(r->events[i & (capacity - 1)]);
+        }
+      }
+#endif
+
+      return result;
+    }
+
+    // writes the events retained by every thread to a binary trace file
+    inline static void dump(const std::string& filename, std::uint32_t node)
+    {
+      std::vector<trace_event> events = collect();
+
+      trace_file_header header;
+      std::memcpy(header.magic, trace_file_header::expected_magic(), sizeof(header.magic));
+      header.node = node;
+      header.event_size = sizeof(trace_event);
+      header.event_count = events.size();
+
+      std::ofstream os(filename, std::ios::binary);
+      if(!os)
+      {
+        throw std::runtime_error("tracer::dump(): Error opening " + filename);
+      }
+
+      os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      os.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(trace_event));
+    }
+
+  private:
+    inline static std::uint64_t now()
+    {
+      auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count();
+    }
+
+    struct ring
+    {
+      std::uint32_t thread;
+      std::atomic<std::uint64_t> head;
+      trace_event events[capacity];
+    };
+
+    struct registry
+    {
+      std::mutex mutex;
+      std::vector<ring*> rings;
+    };
+
+    // the registry and its rings are intentionally leaked so that the events of
+    // threads which have exited remain available to dump()
+    inline static registry& the_registry()
+    {
+      static registry* result = new registry;
+      return *result;
+    }
+
+    inline static ring& this_thread_ring()
+    {
+      static thread_local ring* result = nullptr;
+
+      if(!result)
+      {
+        result = new ring;
+        result->head.store(0, std::memory_order_relaxed);
+
+        registry& reg = the_registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        result->thread = static_cast<std::uint32_t>(reg.rings.size());
+        reg.rings.push_back(result);
+      }
+
+      return *result;
+    }
+};
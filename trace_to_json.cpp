@@ -0,0 +1,139 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// converts the trace files written by execution_context::dump_trace() to the Chrome trace format
+// load the result in chrome://tracing
+//
+// $ ./openshmem-am-root/bin/oshc++ -std=c++11 -DACTIVE_MESSAGE_ENABLE_TRACING context.cpp
+// $ ACTIVE_MESSAGE_TRACE_PREFIX=context ./openshmem-am-root/bin/oshrun ./a.out -n 2
+// $ g++ -std=c++11 trace_to_json.cpp -o trace_to_json
+// $ ./trace_to_json context.0.trace context.1.trace > context.json
+//
+// each node's timestamps are relative to its own clock, so events on different nodes
+// are only directly comparable when those nodes share a host
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+#include "trace.hpp"
+
+
+std::vector<trace_event> read_trace(const char* filename, std::uint32_t& node)
+{
+  std::ifstream is(filename, std::ios::binary);
+  if(!is)
+  {
+    throw std::runtime_error(std::string("read_trace(): Error opening ") + filename);
+  }
+
+  trace_file_header header;
+  is.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+  if(!is ||
+     std::memcmp(header.magic, trace_file_header::expected_magic(), sizeof(header.magic)) != 0 ||
+     header.event_size != sizeof(trace_event))
+  {
+    throw std::runtime_error(std::string("read_trace(): ") + filename + " is not a trace file");
+  }
+
+  node = header.node;
+
+  std::vector<trace_event> result(header.event_count);
+  is.read(reinterpret_cast<char*>(result.data()), result.size() * sizeof(trace_event));
+
+  return result;
+}
+
+
+void write_event(std::ostream& os, std::uint32_t node, const trace_event& e, bool& first)
+{
+  // handler_enter & activate_done bracket a duration
+  // the others are instantaneous
+  const char* phase = "i";
+  const char* name = trace_event_name(e.kind);
+
+  if(e.kind == trace_event_kind::handler_enter)
+  {
+    phase = "B";
+    name = "handler";
+  }
+  else if(e.kind == trace_event_kind::activate_done)
+  {
+    phase = "E";
+    name = "handler";
+  }
+
+  if(!first) os << ",\n";
+  first = false;
+
+  // Chrome expects timestamps in microseconds
+  os << "{\"name\":\"" << name << "\",\"ph\":\"" << phase << "\"";
+  os << ",\"ts\":" << e.timestamp / 1000 << "." << (e.timestamp % 1000) / 100;
+  os << ",\"pid\":" << node << ",\"tid\":" << e.thread;
+  if(*phase == 'i') os << ",\"s\":\"t\"";
+  os << ",\"args\":{\"message_id\":" << e.message_id << ",\"event\":\"" << trace_event_name(e.kind) << "\"}}";
+
+  // connect a message's send to the handler which received it with a flow arrow
+  if(e.kind == trace_event_kind::send || e.kind == trace_event_kind::handler_enter)
+  {
+    const char* flow_phase = e.kind == trace_event_kind::send ? "s" : "f";
+
+    os << ",\n{\"name\":\"message\",\"cat\":\"message\",\"ph\":\"" << flow_phase << "\",\"bp\":\"e\"";
+    os << ",\"id\":" << e.message_id;
+    os << ",\"ts\":" << e.timestamp / 1000 << "." << (e.timestamp % 1000) / 100;
+    os << ",\"pid\":" << node << ",\"tid\":" << e.thread << "}";
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  if(argc < 2)
+  {
+    std::cerr << "usage: " << argv[0] << " trace-file..." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "{\"traceEvents\":[\n";
+
+  bool first = true;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    std::uint32_t node = 0;
+    std::vector<trace_event> events = read_trace(argv[i], node);
+
+    for(const trace_event& e : events)
+    {
+      write_event(std::cout, node, e, first);
+    }
+  }
+
+  std::cout << "\n]}" << std::endl;
+}
@@ -100,7 +100,7 @@ template<class Function, class Tuple>
 struct can_apply_impl
 {
   template<class F,
-           class Result = decltype(apply(std::declval<Function>(), std::declval<Tuple>()))
+           class Result = decltype(::apply(std::declval<Function>(), std::declval<Tuple>()))
           >
   static std::true_type test(int);
 
@@ -115,7 +115,7 @@ using can_apply = typename can_apply_impl<Function,Tuple>::type;
 
 
 template<class Function, class Tuple>
-using apply_result_t = decltype(apply(std::declval<Function>(), std::declval<Tuple>()));
+using apply_result_t = decltype(::apply(std::declval<Function>(), std::declval<Tuple>()));
 
 
 template<class T, class Tuple, std::size_t... I>
@@ -0,0 +1,98 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// $ ./openshmem-am-root/bin/oshc++ -std=c++11 work_stealing.cpp 
+// $ ./openshmem-am-root/bin/oshrun ./a.out -n 4
+// PE 0: executed ... tasks, stole ...
+// PE 1: executed ... tasks, stole ...
+// PE 2: executed ... tasks, stole ...
+// PE 3: executed ... tasks, stole ...
+// PE 0: searched 100163 tree nodes
+//
+// every task starts on node 0, but the search is spread across every node by stealing,
+// so the split of executed tasks varies from run to run
+
+#include <iostream>
+#include <atomic>
+#include <cstdint>
+
+#include "work_stealing.hpp"
+
+
+// the number of tree nodes searched by this node
+std::atomic<std::uint64_t> num_searched{0};
+
+std::uint64_t get_num_searched()
+{
+  return num_searched.load();
+}
+
+
+// the shape of the tree is irregular: a node's number of children is a pseudorandom function of its label
+void search(std::uint64_t label, int depth)
+{
+  ++num_searched;
+
+  std::uint64_t hash = label * 0x9e3779b97f4a7c15ull;
+  hash ^= hash >> 29;
+
+  int num_children = depth < 24 ? static_cast<int>(hash % 4) : 0;
+
+  for(int i = 0; i < num_children; ++i)
+  {
+    work_stealing_scheduler::current().spawn(search, label * 4 + i + 1, depth + 1);
+  }
+}
+
+
+int main()
+{
+  work_stealing_scheduler scheduler;
+
+  if(shmem_my_pe() == 0)
+  {
+    scheduler.spawn(search, std::uint64_t(1), 0);
+  }
+
+  scheduler.run();
+
+  std::cout << "PE " << shmem_my_pe() << ": executed " << scheduler.num_executed() << " tasks, stole " << scheduler.num_stolen() << std::endl;
+
+  shmem_barrier_all();
+
+  if(shmem_my_pe() == 0)
+  {
+    std::uint64_t total = 0;
+    for(std::size_t node = 0; node < system_context().node_count(); ++node)
+    {
+      total += system_context().two_sided_execute(node, get_num_searched).get();
+    }
+
+    std::cout << "PE 0: searched " << total << " tree nodes" << std::endl;
+  }
+
+  shmem_barrier_all();
+}
@@ -0,0 +1,287 @@
+// Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <shmem.h>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <utility>
+#include <stdexcept>
+
+#include "active_message.hpp"
+#include "execution_context.hpp"
+#include "distributed_object.hpp"
+
+
+// task_deque holds the tasks waiting to execute on a node
+// its owner pushes and pops at the back, so it works depth-first on its most recently spawned tasks,
+// while thieves steal from the front, where the oldest and typically largest tasks wait
+class task_deque
+{
+  public:
+    inline void push(active_message task)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.emplace_back(std::move(task));
+    }
+
+    inline void push(std::vector<active_message>&& tasks)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for(active_message& task : tasks)
+      {
+        tasks_.emplace_back(std::move(task));
+      }
+    }
+
+    inline bool try_pop(active_message& task)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      if(tasks_.empty()) return false;
+
+      task = std::move(tasks_.back());
+      tasks_.pop_back();
+      return true;
+    }
+
+    // removes up to max_tasks, but no more than half, of the tasks from the front
+    inline std::vector<active_message> steal(std::size_t max_tasks)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      std::size_t n = std::min(max_tasks, (tasks_.size() + 1) / 2);
+
+      std::vector<active_message> result;
+      result.reserve(n);
+
+      for(std::size_t i = 0; i < n; ++i)
+      {
+        result.emplace_back(std::move(tasks_.front()));
+        tasks_.pop_front();
+      }
+
+      return result;
+    }
+
+    inline std::size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return tasks_.size();
+    }
+
+  private:
+    mutable std::mutex mutex_;
+    std::deque<active_message> tasks_;
+};
+
+
+// work_stealing_scheduler executes tasks across every node
+// each node executes the tasks in its own task_deque, and a node whose deque runs dry
+// steals a batch of tasks from a randomly chosen victim with a two-sided message
+//
+// the scheduler finishes when every task has finished: a counter on node 0 counts the tasks which
+// have been spawned but have not yet finished, so a task in transit to a thief still counts
+//
+// constructing a work_stealing_scheduler is a collective operation:
+// every node must construct its work_stealing_scheduler in the same order
+class work_stealing_scheduler
+{
+  public:
+    // a thief takes at most steal_batch tasks at once
+    inline explicit work_stealing_scheduler(std::size_t steal_batch = 16)
+      : steal_batch_(steal_batch),
+        num_unfinished_(static_cast<long*>(shmem_malloc(sizeof(long)))),
+        num_executed_{0},
+        num_stolen_{0},
+        num_failed_steals_{0}
+    {
+      *num_unfinished_ = 0;
+
+      // make sure node 0's counter is initialized and every node's deque exists before any task is spawned
+      shmem_barrier_all();
+    }
+
+    // XXX note that we don't call shmem_free() because shmem may already have been shutdown
+
+    // adds the task f(args...) to this node's deque
+    // tasks may spawn more tasks, with work_stealing_scheduler::current().spawn()
+    template<class Function, class... Args,
+             __REQUIRES(can_serialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(can_deserialize_all<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value),
+             __REQUIRES(is_invocable<typename std::decay<Function>::type,typename std::decay<Args>::type...>::value)
+            >
+    void spawn(Function&& f, Args&&... args)
+    {
+      active_message task(std::forward<Function>(f), std::forward<Args>(args)...);
+
+      // count the task before it can possibly finish
+      // nonfetching atomics may complete out of order, so a thief's decrement could overtake this increment
+      // and let the count reach zero early; a fetching atomic has completed by the time it returns
+      shmem_long_fadd(num_unfinished_, 1, 0);
+
+      deque_.local().push(std::move(task));
+    }
+
+    // executes tasks, stealing from other nodes as necessary, until every node's tasks have finished
+    // every node must call run(); several threads of a node may call it at once
+    inline void run()
+    {
+      // wait for every node's initial tasks to be counted
+      shmem_barrier_all();
+
+      work_stealing_scheduler* previous = current_ptr();
+      current_ptr() = this;
+
+      std::minstd_rand random(static_cast<unsigned int>(shmem_my_pe() + 1));
+      std::chrono::microseconds backoff(0);
+
+      active_message task;
+
+      while(true)
+      {
+        if(deque_.local().try_pop(task))
+        {
+          task.activate();
+          ++num_executed_;
+
+          shmem_long_add(num_unfinished_, -1, 0);
+          continue;
+        }
+
+        if(shmem_long_fetch(num_unfinished_, 0) == 0) break;
+
+        if(try_steal(random))
+        {
+          backoff = std::chrono::microseconds(0);
+        }
+        else
+        {
+          // other nodes are busy with tasks they can't share yet; don't flood them with requests
+          backoff = std::min(max_backoff(), backoff * 2 + std::chrono::microseconds(1));
+          std::this_thread::sleep_for(backoff);
+        }
+      }
+
+      current_ptr() = previous;
+    }
+
+    // returns the scheduler whose run() is executing the calling thread's current task
+    inline static work_stealing_scheduler& current()
+    {
+      if(!current_ptr())
+      {
+        throw std::runtime_error("work_stealing_scheduler::current(): Not called from a task.");
+      }
+
+      return *current_ptr();
+    }
+
+    // returns the number of tasks waiting in this node's deque
+    inline std::size_t size() const
+    {
+      return deque_.local().size();
+    }
+
+    // returns the number of tasks this node has executed
+    inline std::size_t num_executed() const
+    {
+      return num_executed_.load();
+    }
+
+    // returns the number of tasks this node has stolen from others
+    inline std::size_t num_stolen() const
+    {
+      return num_stolen_.load();
+    }
+
+    // returns the number of steal requests which came back empty
+    inline std::size_t num_failed_steals() const
+    {
+      return num_failed_steals_.load();
+    }
+
+  private:
+    // thieves also wait on the polling thread of their victim, so set ACTIVE_MESSAGE_POLL_INTERVAL_MICROSECONDS
+    // to something small when tasks are short
+    inline static std::chrono::microseconds max_backoff()
+    {
+      return std::chrono::microseconds(1000);
+    }
+
+    inline static work_stealing_scheduler*& current_ptr()
+    {
+      static thread_local work_stealing_scheduler* result = nullptr;
+      return result;
+    }
+
+    // returns true if any tasks were stolen
+    template<class RandomNumberGenerator>
+    bool try_steal(RandomNumberGenerator& random)
+    {
+      std::size_t num_nodes = shmem_n_pes();
+      if(num_nodes < 2) return false;
+
+      // choose a victim other than this node
+      std::size_t victim = random() % (num_nodes - 1);
+      if(victim >= static_cast<std::size_t>(shmem_my_pe())) ++victim;
+
+      // a steal is short, so the victim answers it immediately rather than after its queued messages
+      std::vector<active_message> stolen =
+        system_context().two_sided_execute(message_priority::high, victim, &steal_from, deque_.id(), steal_batch_).get();
+
+      if(stolen.empty())
+      {
+        ++num_failed_steals_;
+        return false;
+      }
+
+      num_stolen_ += stolen.size();
+      deque_.local().push(std::move(stolen));
+      return true;
+    }
+
+    // this function is what a thief sends to its victim
+    inline static std::vector<active_message> steal_from(std::size_t deque_id, std::size_t max_tasks)
+    {
+      task_deque* victim = static_cast<task_deque*>(distributed_object_registry::find(deque_id));
+      return victim ? victim->steal(max_tasks) : std::vector<active_message>();
+    }
+
+    distributed_object<task_deque> deque_;
+    std::size_t steal_batch_;
+    long* num_unfinished_;
+    std::atomic<std::size_t> num_executed_;
+    std::atomic<std::size_t> num_stolen_;
+    std::atomic<std::size_t> num_failed_steals_;
+};